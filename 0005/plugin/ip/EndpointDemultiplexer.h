@@ -0,0 +1,248 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_ENDPOINTDEMULTIPLEXER_H
+#define INCLUDED_OSCPACK_ENDPOINTDEMULTIPLEXER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "IpEndpointName.h"
+#include "PacketListener.h"
+#include "TimerListener.h"
+
+
+// Creates and releases the listener that receives the datagrams of one
+// source. Both are called on the thread running the multiplexer.
+class EndpointListenerFactory{
+public:
+    virtual ~EndpointListenerFactory() {}
+
+    // called for the first datagram from a source. return 0 to ignore the
+    // source, it is asked again on its next datagram.
+    virtual PacketListener* CreateListener( const IpEndpointName& remoteEndpoint ) = 0;
+
+    // called once the source has been idle for the timeout, or when the
+    // demultiplexer is destroyed
+    virtual void ReleaseListener( const IpEndpointName& remoteEndpoint, PacketListener *listener ) = 0;
+};
+
+
+// Routes the datagrams arriving on one socket to a listener per source
+// address and port, so several senders can share a port and a receive
+// thread. Attach it to a SocketReceiveMultiplexer as the socket's listener
+// and as a periodic timer listener on the same multiplexer: a source which
+// sends nothing for idleTicks consecutive timer periods is released.
+//
+// Sources live in an open addressing table with linear probing, so the
+// per datagram lookup is a hash and usually a single comparison. At most
+// maxSources are tracked, datagrams from further sources are dropped and
+// counted, which bounds the table when senders spoof addresses. Not thread
+// safe, everything happens on the multiplexer thread.
+
+class EndpointDemultiplexer : public PacketListener, public TimerListener{
+    struct Entry{
+        IpEndpointName remoteEndpoint;
+        PacketListener *listener; // 0 marks an empty entry
+        unsigned long long lastTick;
+    };
+
+    EndpointListenerFactory *factory_;
+    unsigned long long idleTicks_;
+    std::size_t maxSources_;
+
+    std::vector< Entry > table_; // size is a power of two
+    std::size_t count_;
+    unsigned long long tick_;
+    unsigned long long rejected_;
+
+    std::size_t Mask() const { return table_.size() - 1; }
+
+    static std::size_t Hash( const IpEndpointName& endpoint )
+    {
+        // fibonacci hashing, the high bits of the product are well mixed
+        unsigned long long key = ( (unsigned long long)( endpoint.address & 0xFFFFFFFFUL ) << 16 )
+                ^ (unsigned long long)( endpoint.port & 0xFFFF );
+        return (std::size_t)( ( key * 0x9E3779B97F4A7C15ULL ) >> 32 );
+    }
+
+    // the entry holding remoteEndpoint, or the empty entry where it belongs
+    std::size_t Find( const IpEndpointName& remoteEndpoint ) const
+    {
+        std::size_t i = Hash( remoteEndpoint ) & Mask();
+        while( table_[i].listener && table_[i].remoteEndpoint != remoteEndpoint )
+            i = (i + 1) & Mask();
+        return i;
+    }
+
+    void Grow()
+    {
+        std::vector< Entry > old( table_.size() * 2 );
+        old.swap( table_ );
+        for( std::size_t i=0; i < table_.size(); ++i )
+            table_[i].listener = 0;
+
+        for( std::size_t i=0; i < old.size(); ++i ){
+            if( old[i].listener )
+                table_[ Find( old[i].remoteEndpoint ) ] = old[i];
+        }
+    }
+
+    // removes entry i and shifts later members of its probe sequence back,
+    // so lookups never need tombstones
+    void Erase( std::size_t i )
+    {
+        table_[i].listener = 0;
+        --count_;
+
+        std::size_t j = i;
+        for(;;){
+            j = (j + 1) & Mask();
+            if( !table_[j].listener )
+                break;
+
+            // move j into the hole at i unless its home lies cyclically in (i, j]
+            std::size_t home = Hash( table_[j].remoteEndpoint ) & Mask();
+            if( ( (j - home) & Mask() ) >= ( (j - i) & Mask() ) ){
+                table_[i] = table_[j];
+                table_[j].listener = 0;
+                i = j;
+            }
+        }
+    }
+
+public:
+    EndpointDemultiplexer( EndpointListenerFactory *factory, int idleTicks, std::size_t maxSources=64 )
+        : factory_( factory )
+        , idleTicks_( (idleTicks > 0) ? (unsigned long long)idleTicks : 1 )
+        , maxSources_( maxSources )
+        , table_( 16 )
+        , count_( 0 )
+        , tick_( 0 )
+        , rejected_( 0 )
+    {
+        for( std::size_t i=0; i < table_.size(); ++i )
+            table_[i].listener = 0;
+    }
+
+    virtual ~EndpointDemultiplexer()
+    {
+        for( std::size_t i=0; i < table_.size(); ++i ){
+            if( table_[i].listener )
+                factory_->ReleaseListener( table_[i].remoteEndpoint, table_[i].listener );
+        }
+    }
+
+    std::size_t SourceCount() const { return count_; }
+
+    // datagrams dropped because maxSources were already tracked
+    unsigned long long RejectedCount() const { return rejected_; }
+
+    // the listener for remoteEndpoint, or 0 if it isn't a tracked source
+    PacketListener* Listener( const IpEndpointName& remoteEndpoint ) const
+    {
+        return table_[ Find( remoteEndpoint ) ].listener;
+    }
+
+    virtual void ProcessPacket( const char *data, int size,
+			const IpEndpointName& remoteEndpoint )
+    {
+        PacketListener *listener = Route( remoteEndpoint );
+        if( listener )
+            listener->ProcessPacket( data, size, remoteEndpoint );
+    }
+
+    virtual void ProcessTimestampedPacket( const char *data, int size,
+			const IpEndpointName& remoteEndpoint, long long arrivalTimeNs )
+    {
+        PacketListener *listener = Route( remoteEndpoint );
+        if( listener )
+            listener->ProcessTimestampedPacket( data, size, remoteEndpoint, arrivalTimeNs );
+    }
+
+    // releases the sources which were idle for idleTicks ticks
+    virtual void TimerExpired()
+    {
+        ++tick_;
+
+        std::size_t i = 0;
+        while( i < table_.size() ){
+            Entry& entry = table_[i];
+            if( entry.listener && tick_ - entry.lastTick >= idleTicks_ ){
+                const IpEndpointName remoteEndpoint = entry.remoteEndpoint;
+                PacketListener *listener = entry.listener;
+                Erase( i );
+                factory_->ReleaseListener( remoteEndpoint, listener );
+                // Erase() may have shifted an unvisited entry into i
+            }else{
+                ++i;
+            }
+        }
+    }
+
+private:
+    PacketListener* Route( const IpEndpointName& remoteEndpoint )
+    {
+        std::size_t i = Find( remoteEndpoint );
+        if( table_[i].listener ){
+            table_[i].lastTick = tick_;
+            return table_[i].listener;
+        }
+
+        if( count_ >= maxSources_ ){
+            ++rejected_;
+            return 0;
+        }
+
+        PacketListener *listener = factory_->CreateListener( remoteEndpoint );
+        if( !listener )
+            return 0;
+
+        // keep the load factor at or below one half
+        if( (count_ + 1) * 2 > table_.size() ){
+            Grow();
+            i = Find( remoteEndpoint );
+        }
+
+        table_[i].remoteEndpoint = remoteEndpoint;
+        table_[i].listener = listener;
+        table_[i].lastTick = tick_;
+        ++count_;
+        return listener;
+    }
+};
+
+#endif /* INCLUDED_OSCPACK_ENDPOINTDEMULTIPLEXER_H */
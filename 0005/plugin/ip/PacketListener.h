@@ -45,6 +45,17 @@ public:
     virtual ~PacketListener() {}
     virtual void ProcessPacket( const char *data, int size, 
 			const IpEndpointName& remoteEndpoint ) = 0;
+
+    // Called instead of ProcessPacket() for sockets that have receive
+    // timestamps enabled (see UdpSocket::SetEnableReceiveTimestamps()).
+    // arrivalTimeNs is when the datagram arrived, in nanoseconds on the
+    // std::chrono::steady_clock timeline.
+    virtual void ProcessTimestampedPacket( const char *data, int size,
+			const IpEndpointName& remoteEndpoint, long long arrivalTimeNs )
+    {
+        (void) arrivalTimeNs;
+        ProcessPacket( data, size, remoteEndpoint );
+    }
 };
 
 #endif /* INCLUDED_OSCPACK_PACKETLISTENER_H */
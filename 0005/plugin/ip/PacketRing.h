@@ -0,0 +1,196 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_PACKETRING_H
+#define INCLUDED_OSCPACK_PACKETRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "IpEndpointName.h"
+#include "PacketListener.h"
+
+
+// Single producer, single consumer ring of fixed size datagram slots.
+// Attach it to a SocketReceiveMultiplexer as the listener for a socket and
+// the receive thread only copies each datagram, with its endpoint and
+// arrival time, into the next free slot. Another thread calls Dispatch()
+// to hand the queued datagrams to the real listener in batches, so parsing
+// happens there and neither side takes a lock.
+//
+// Datagrams which don't fit in a slot, or arrive while the ring is full,
+// are dropped and counted. Only one thread may produce (the multiplexer
+// running the socket) and only one may call Dispatch() at a time.
+
+class PacketRing : public PacketListener{
+    struct SlotHeader{
+        long long arrivalTimeNs;
+        unsigned long address;
+        int port;
+        int size;
+    };
+
+    enum { CACHE_LINE_SIZE = 64 };
+
+    std::size_t slotCount_;
+    std::size_t slotStride_;
+    std::size_t slotSize_;
+    std::vector< char > storage_;
+
+    // the padding keeps the producer and consumer indices on separate
+    // cache lines
+    char padding0_[ CACHE_LINE_SIZE ];
+    std::atomic< std::size_t > head_; // next slot to write
+    std::size_t cachedTail_; // producer's last view of tail_
+    std::atomic< unsigned long long > dropped_;
+
+    char padding1_[ CACHE_LINE_SIZE ];
+    std::atomic< std::size_t > tail_; // next slot to read
+    char padding2_[ CACHE_LINE_SIZE ];
+
+    char *Slot( std::size_t index )
+    {
+        return &storage_[ ( index & (slotCount_ - 1) ) * slotStride_ ];
+    }
+
+    static std::size_t RoundUpToPowerOfTwo( std::size_t n )
+    {
+        std::size_t result = 1;
+        while( result < n )
+            result <<= 1;
+        return result;
+    }
+
+public:
+    // slotCount is rounded up to a power of two, slotSize is the largest
+    // datagram a slot holds
+    PacketRing( std::size_t slotCount, std::size_t slotSize )
+        : slotCount_( RoundUpToPowerOfTwo( slotCount ) )
+        , slotStride_( ( sizeof(SlotHeader) + slotSize + CACHE_LINE_SIZE - 1 ) & ~std::size_t( CACHE_LINE_SIZE - 1 ) )
+        , slotSize_( slotSize )
+        , storage_( slotCount_ * slotStride_ )
+        , head_( 0 )
+        , cachedTail_( 0 )
+        , dropped_( 0 )
+        , tail_( 0 )
+    {
+    }
+
+    std::size_t SlotCount() const { return slotCount_; }
+    std::size_t SlotSize() const { return slotSize_; }
+
+    // datagrams dropped since construction
+    unsigned long long DroppedCount() const { return dropped_.load( std::memory_order_relaxed ); }
+
+    // approximate when called from a third thread
+    std::size_t QueuedCount() const
+    {
+        return head_.load( std::memory_order_acquire ) - tail_.load( std::memory_order_acquire );
+    }
+
+    virtual void ProcessPacket( const char *data, int size,
+			const IpEndpointName& remoteEndpoint )
+    {
+        ProcessTimestampedPacket( data, size, remoteEndpoint, 0 );
+    }
+
+    // producer side
+    virtual void ProcessTimestampedPacket( const char *data, int size,
+			const IpEndpointName& remoteEndpoint, long long arrivalTimeNs )
+    {
+        const std::size_t head = head_.load( std::memory_order_relaxed );
+
+        if( size < 0 || (std::size_t)size > slotSize_ ){
+            dropped_.fetch_add( 1, std::memory_order_relaxed );
+            return;
+        }
+
+        if( head - cachedTail_ == slotCount_ ){
+            cachedTail_ = tail_.load( std::memory_order_acquire );
+            if( head - cachedTail_ == slotCount_ ){
+                dropped_.fetch_add( 1, std::memory_order_relaxed );
+                return;
+            }
+        }
+
+        char *slot = Slot( head );
+        SlotHeader header;
+        header.arrivalTimeNs = arrivalTimeNs;
+        header.address = remoteEndpoint.address;
+        header.port = remoteEndpoint.port;
+        header.size = size;
+        std::memcpy( slot, &header, sizeof(header) );
+        std::memcpy( slot + sizeof(header), data, size );
+
+        head_.store( head + 1, std::memory_order_release );
+    }
+
+    // consumer side. hands up to maxPackets queued datagrams to listener
+    // in arrival order and returns how many were dispatched. datagrams
+    // which arrived without a timestamp are passed to ProcessPacket().
+    std::size_t Dispatch( PacketListener *listener, std::size_t maxPackets=~std::size_t( 0 ) )
+    {
+        std::size_t tail = tail_.load( std::memory_order_relaxed );
+
+        std::size_t available = head_.load( std::memory_order_acquire ) - tail;
+        if( available > maxPackets )
+            available = maxPackets;
+
+        for( std::size_t i=0; i < available; ++i ){
+            const char *slot = Slot( tail );
+            SlotHeader header;
+            std::memcpy( &header, slot, sizeof(header) );
+            const IpEndpointName remoteEndpoint( header.address, header.port );
+            const char *data = slot + sizeof(header);
+
+            if( header.arrivalTimeNs != 0 )
+                listener->ProcessTimestampedPacket( data, header.size, remoteEndpoint, header.arrivalTimeNs );
+            else
+                listener->ProcessPacket( data, header.size, remoteEndpoint );
+
+            // release each slot as soon as it's consumed so the producer
+            // can refill the ring during a long batch
+            ++tail;
+            tail_.store( tail, std::memory_order_release );
+        }
+
+        return available;
+    }
+};
+
+#endif /* INCLUDED_OSCPACK_PACKETRING_H */
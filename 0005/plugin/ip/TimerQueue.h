@@ -0,0 +1,162 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_TIMERQUEUE_H
+#define INCLUDED_OSCPACK_TIMERQUEUE_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "TimerListener.h"
+
+
+// Binary min-heap of periodic timers keyed on integer nanosecond deadlines.
+// Used by the SocketReceiveMultiplexer backends: rescheduling the expired
+// timer is O(log n) and deadlines advance by whole periods, so they don't
+// drift. Ties are broken by id, so timers due at the same time fire in the
+// order they were attached. Not thread safe, the multiplexer locks around it.
+
+class TimerQueue{
+    struct ScheduledTimer{
+        long long deadlineNs;
+        long long periodNs;
+        unsigned long long id;
+        TimerListener *listener;
+    };
+
+    std::vector< ScheduledTimer > heap_;
+
+    static bool Earlier( const ScheduledTimer& lhs, const ScheduledTimer& rhs )
+    {
+        return ( lhs.deadlineNs < rhs.deadlineNs )
+                || ( lhs.deadlineNs == rhs.deadlineNs && lhs.id < rhs.id );
+    }
+
+    void SiftUp( std::size_t i )
+    {
+        ScheduledTimer t = heap_[i];
+        while( i > 0 ){
+            std::size_t parent = (i - 1) / 2;
+            if( !Earlier( t, heap_[parent] ) )
+                break;
+            heap_[i] = heap_[parent];
+            i = parent;
+        }
+        heap_[i] = t;
+    }
+
+    void SiftDown( std::size_t i )
+    {
+        const std::size_t n = heap_.size();
+        ScheduledTimer t = heap_[i];
+        for(;;){
+            std::size_t child = 2 * i + 1;
+            if( child >= n )
+                break;
+            if( child + 1 < n && Earlier( heap_[child + 1], heap_[child] ) )
+                ++child;
+            if( !Earlier( heap_[child], t ) )
+                break;
+            heap_[i] = heap_[child];
+            i = child;
+        }
+        heap_[i] = t;
+    }
+
+public:
+    bool Empty() const { return heap_.empty(); }
+    std::size_t Size() const { return heap_.size(); }
+
+    void Clear() { heap_.clear(); }
+
+    // id identifies the timer for Remove(), it must be unique in the queue.
+    void Schedule( unsigned long long id, long long deadlineNs, long long periodNs, TimerListener *listener )
+    {
+        ScheduledTimer t;
+        t.deadlineNs = deadlineNs;
+        t.periodNs = ( periodNs > 0 ) ? periodNs : 1;
+        t.id = id;
+        t.listener = listener;
+
+        heap_.push_back( t );
+        SiftUp( heap_.size() - 1 );
+    }
+
+    bool Remove( unsigned long long id )
+    {
+        for( std::size_t i = 0; i < heap_.size(); ++i ){
+            if( heap_[i].id == id ){
+                heap_[i] = heap_.back();
+                heap_.pop_back();
+                if( i < heap_.size() ){
+                    SiftDown( i );
+                    SiftUp( i );
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // only valid when the queue is not empty
+    long long NextDeadlineNs() const
+    {
+        assert( !heap_.empty() );
+        return heap_.front().deadlineNs;
+    }
+
+    // if the earliest timer is due at nowNs, move it to its next deadline and
+    // return its listener, otherwise return 0. the next deadline is always
+    // after nowNs, so a timer is returned at most once for a given nowNs and
+    // periods that were missed entirely are skipped rather than replayed.
+    TimerListener *PopExpired( long long nowNs )
+    {
+        if( heap_.empty() || heap_.front().deadlineNs > nowNs )
+            return 0;
+
+        ScheduledTimer& t = heap_.front();
+        t.deadlineNs += t.periodNs;
+        if( t.deadlineNs <= nowNs )
+            t.deadlineNs += ( (nowNs - t.deadlineNs) / t.periodNs + 1 ) * t.periodNs;
+
+        TimerListener *listener = t.listener;
+        SiftDown( 0 );
+        return listener;
+    }
+};
+
+#endif /* INCLUDED_OSCPACK_TIMERQUEUE_H */
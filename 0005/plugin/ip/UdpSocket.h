@@ -48,6 +48,101 @@ class TimerListener;
 
 class UdpSocket;
 
+
+// one datagram for UdpSocket::SendMultiple()
+struct OutgoingDatagram{
+    const char *data;
+    std::size_t size;
+    IpEndpointName remoteEndpoint;
+};
+
+
+// counters maintained by SocketReceiveMultiplexer::Run(). they are
+// cumulative over the lifetime of the multiplexer and may be queried
+// from any thread with SocketReceiveMultiplexer::GetStatistics().
+struct SocketReceiveStatistics{
+    enum { LATENCY_BUCKETS = 24 };
+
+    SocketReceiveStatistics()
+        : wakeups( 0 ), batches( 0 ), datagrams( 0 ), maxBatchDepth( 0 )
+        , drainBudgetExhausted( 0 ), maxReceiveQueueBytes( 0 ), kernelDrops( 0 )
+        , truncatedDatagrams( 0 ), spinPolls( 0 ), spinPollsWithData( 0 ), blockingWaits( 0 )
+    {
+        for( int i=0; i < LATENCY_BUCKETS; ++i )
+            wakeToDispatch[i] = 0;
+    }
+
+    unsigned long long wakeups;     // returns from the wait with at least one readable socket
+    unsigned long long batches;     // receive calls that returned at least one datagram
+    unsigned long long datagrams;   // datagrams dispatched to a PacketListener
+    unsigned int maxBatchDepth;     // most datagrams returned by a single receive call
+
+    // drain-until-empty mode only: the number of times a socket still had
+    // data queued when its per-iteration budget ran out, and the deepest
+    // kernel receive queue (see UdpSocket::ReceiveQueueBytes()) seen then.
+    unsigned long long drainBudgetExhausted;
+    unsigned long long maxReceiveQueueBytes;
+
+    // datagrams the kernel dropped because a socket's receive buffer was
+    // full, for sockets with drop counting enabled (see
+    // UdpSocket::SetEnableDropCounting()).
+    unsigned long long kernelDrops;
+
+    // datagrams larger than a receive buffer, which are dropped rather than
+    // dispatched cut short. they are counted in datagrams and batches too.
+    // never counted on win32, where such datagrams are dropped by winsock.
+    unsigned long long truncatedDatagrams;
+
+    // busy-poll mode only: non-blocking passes over all sockets and how many
+    // of them found data. blockingWaits counts every call to the blocking
+    // wait in either mode.
+    unsigned long long spinPolls;
+    unsigned long long spinPollsWithData;
+    unsigned long long blockingWaits;
+
+    // histogram of the time from the loop waking up (the wait returning, or
+    // the start of a spin poll pass) to the first datagram of each batch
+    // being dispatched. see LatencyBucket() for the bucket boundaries.
+    unsigned long long wakeToDispatch[ LATENCY_BUCKETS ];
+
+    // average number of datagrams delivered per receive call
+    double AverageBatchDepth() const
+        { return (batches > 0) ? (double)datagrams / (double)batches : 0.; }
+
+    // fraction of loop iterations which spun rather than blocked
+    double SpinRatio() const
+        { return (spinPolls + blockingWaits > 0) ? (double)spinPolls / (double)(spinPolls + blockingWaits) : 0.; }
+
+    // bucket i counts latencies in [2^i, 2^(i+1)) nanoseconds, bucket 0 also
+    // counts anything shorter and the last bucket anything longer.
+    static int LatencyBucket( long long latencyNs )
+    {
+        int bucket = 0;
+        while( latencyNs > 1 && bucket < LATENCY_BUCKETS - 1 ){
+            latencyNs >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+};
+
+
+// how SocketReceiveMultiplexer waits for and receives datagrams
+enum SocketReceiveBackend{
+    // block in epoll_wait() (linux) or WaitForMultipleObjects() (windows)
+    // and then read the readable sockets
+    WAIT_RECEIVE_BACKEND,
+
+    // linux only: arm one io_uring multishot recvmsg per socket which
+    // receives into a ring of preregistered buffers, so that a single
+    // io_uring_enter() collects every datagram that arrived since the last
+    // one. falls back to WAIT_RECEIVE_BACKEND on other platforms and on
+    // kernels older than 6.0. experimental: it has not been shown to beat
+    // WAIT_RECEIVE_BACKEND, compare them with tools/UdpReceiveBench.
+    IO_URING_RECEIVE_BACKEND
+};
+
+
 class SocketReceiveMultiplexer{
     class Implementation;
     Implementation *impl_;
@@ -55,24 +150,56 @@ class SocketReceiveMultiplexer{
 	friend class UdpSocket;
 
 public:
-    SocketReceiveMultiplexer();
+    explicit SocketReceiveMultiplexer( SocketReceiveBackend backend=WAIT_RECEIVE_BACKEND );
     ~SocketReceiveMultiplexer();
 
-	// only call the attach/detach methods _before_ calling Run
+    // the backend actually in use, which differs from the one requested
+    // at construction when that one isn't available
+    SocketReceiveBackend Backend() const;
+
+	// only call the socket attach/detach methods _before_ calling Run
 
     // only one listener per socket, each socket at most once
     void AttachSocketListener( UdpSocket *socket, PacketListener *listener );
     void DetachSocketListener( UdpSocket *socket, PacketListener *listener );
 
+    // timers may be attached and detached at any time, including from
+    // another thread or from TimerExpired() while Run is active. once
+    // DetachPeriodicTimerListener() returns the listener won't be called again.
     void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener );
 	void AttachPeriodicTimerListener(
             int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener );
     void DetachPeriodicTimerListener( TimerListener *listener );  
 
+    // read up to batchSize datagrams from a readable socket before going
+    // back to waiting. the datagrams are received into a preallocated slab
+    // (with recvmmsg() where available) and dispatched back-to-back.
+    // the default batch size of 1 reads one datagram per wakeup.
+    // the io_uring backend always collects everything that has arrived and
+    // ignores this and SetDrainUntilEmpty().
+    void SetReceiveBatchSize( int batchSize );
+    int ReceiveBatchSize() const;
+
+    // keep reading a readable socket until it would block instead of going
+    // back to the wait after one batch. at most budget datagrams are read
+    // from each socket per loop iteration so that timers still fire when
+    // the sender outpaces us.
+    void SetDrainUntilEmpty( bool drainUntilEmpty, int budget=256 );
+
+    // spin on non-blocking receives instead of sleeping in the wait, for a
+    // receiver pinned to an otherwise idle core. after idleMicroseconds
+    // without any data the loop backs off to one blocking wait and resumes
+    // spinning as soon as that wait returns data. a negative idle period
+    // spins indefinitely, timers are serviced between spin passes either way.
+    void SetBusyPoll( bool busyPoll, int idleMicroseconds=-1 );
+
+    void GetStatistics( SocketReceiveStatistics& statistics ) const;
+
     void Run();      // loop and block processing messages indefinitely
 	void RunUntilSigInt();
     void Break();    // call this from a listener to exit once the listener returns
-    void AsynchronousBreak(); // call this from another thread or signal handler to exit the Run() state
+    void AsynchronousBreak(); // call this from another thread or signal handler to exit the Run() state,
+                              // before Run() is entered it makes that Run() return at once
 };
 
 
@@ -102,6 +229,62 @@ public:
 	// operating systems.
 	void SetAllowReuse( bool allowReuse );
 
+	// Let several sockets bind the same address and port and have the
+	// kernel load balance incoming datagrams between them, hashed by the
+	// sender's address so each source always lands on the same socket.
+	// Sets SO_REUSEPORT on Linux. Must be called before Bind(). Returns
+	// false if the platform has no load balancing port reuse (Windows),
+	// in which case the socket is left unchanged.
+	bool SetAllowReusePort( bool allowReusePort );
+
+	// Deliver datagrams received by a SocketReceiveMultiplexer through
+	// PacketListener::ProcessTimestampedPacket() with their arrival time.
+	// On Linux this is the kernel receive timestamp (SO_TIMESTAMPNS). Other
+	// platforms take the timestamp in user space right after the datagram
+	// is read from the socket, before anything in the batch is dispatched.
+	void SetEnableReceiveTimestamps( bool enableReceiveTimestamps );
+
+	// Size the kernel receive and send buffers (SO_RCVBUF, SO_SNDBUF). A
+	// receive buffer deep enough for the longest stall of the receiving
+	// thread keeps bursts from being dropped. Returns the size in effect
+	// afterwards, as reported by the system: Linux doubles the request to
+	// account for its bookkeeping and caps it at net.core.rmem_max
+	// (wmem_max) unless the process has CAP_NET_ADMIN.
+	int SetReceiveBufferSize( int size );
+	int SetSendBufferSize( int size );
+	int ReceiveBufferSize() const;
+	int SendBufferSize() const;
+
+	// Count the datagrams the kernel drops because the receive buffer is
+	// full and report them in SocketReceiveStatistics::kernelDrops. Uses
+	// SO_RXQ_OVFL, which attaches the running count to received datagrams,
+	// so drops are counted when the next datagram gets through. Returns
+	// false if the platform can't count drops (Windows).
+	bool SetEnableDropCounting( bool enableDropCounting );
+
+
+	// Multicast. To receive from a group bind the group port (usually to
+	// the any address) then join the group. interfaceAddress selects the
+	// network interface by its address, ANY_ADDRESS lets the system choose.
+	// Joining several groups, or the same group on several interfaces, is
+	// allowed. Throws std::runtime_error if the group can't be joined.
+	void JoinMulticastGroup( const IpEndpointName& group,
+			unsigned long interfaceAddress=IpEndpointName::ANY_ADDRESS );
+	void LeaveMulticastGroup( const IpEndpointName& group,
+			unsigned long interfaceAddress=IpEndpointName::ANY_ADDRESS );
+
+	// Interface used to send multicast datagrams (IP_MULTICAST_IF).
+	void SetMulticastInterface( unsigned long interfaceAddress );
+
+	// Number of routers a multicast datagram may cross (IP_MULTICAST_TTL).
+	// The default of 1 keeps it on the local network.
+	void SetMulticastTimeToLive( int timeToLive );
+
+	// Loop multicast datagrams back to members of the group on this host
+	// (IP_MULTICAST_LOOP), enabled by default. Linux applies this to the
+	// sending socket, Windows to the receiving one.
+	void SetEnableMulticastLoopback( bool enableLoopback );
+
 
 	// The socket is created in an unbound, unconnected state
 	// such a socket can only be used to send to an arbitrary
@@ -119,6 +302,11 @@ public:
 	void Send( const char *data, std::size_t size );
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size );
 
+	// Send each datagram to its remoteEndpoint as SendTo() would, but with
+	// as few system calls as possible (sendmmsg() where available).
+	// Returns the number of datagrams which were sent.
+	std::size_t SendMultiple( const OutgoingDatagram *datagrams, std::size_t count );
+
 
 	// Bind a local endpoint to receive incoming data. Endpoint
 	// can be 'any' for the system to choose an endpoint
@@ -126,6 +314,12 @@ public:
 	bool IsBound() const;
 
     std::size_t ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size );
+
+	// Number of bytes waiting in the kernel receive queue. On Windows this
+	// is the payload of all queued datagrams (FIONREAD), on Linux it is the
+	// memory charged to the socket receive buffer (SO_MEMINFO) which also
+	// counts per-datagram kernel overhead.
+	std::size_t ReceiveQueueBytes() const;
 };
 
 
@@ -145,6 +339,16 @@ class UdpReceiveSocket : public UdpSocket{
 public:
 	UdpReceiveSocket( const IpEndpointName& localEndpoint )
 		{ Bind( localEndpoint ); }
+
+	// bind with address reuse, so other processes on this host can
+	// listen to the same group, and join multicastGroup
+	UdpReceiveSocket( const IpEndpointName& localEndpoint, const IpEndpointName& multicastGroup,
+			unsigned long interfaceAddress=IpEndpointName::ANY_ADDRESS )
+	{
+		SetAllowReuse( true );
+		Bind( localEndpoint );
+		JoinMulticastGroup( multicastGroup, interfaceAddress );
+	}
 };
 
 
@@ -166,6 +370,11 @@ public:
         { mux_.DetachSocketListener( this, listener_ ); }
 
     // see SocketReceiveMultiplexer above for the behaviour of these methods...
+    void SetReceiveBatchSize( int batchSize ) { mux_.SetReceiveBatchSize( batchSize ); }
+    void SetDrainUntilEmpty( bool drainUntilEmpty, int budget=256 ) { mux_.SetDrainUntilEmpty( drainUntilEmpty, budget ); }
+    void SetBusyPoll( bool busyPoll, int idleMicroseconds=-1 ) { mux_.SetBusyPoll( busyPoll, idleMicroseconds ); }
+    void GetStatistics( SocketReceiveStatistics& statistics ) const { mux_.GetStatistics( statistics ); }
+
     void Run() { mux_.Run(); }
 	void RunUntilSigInt() { mux_.RunUntilSigInt(); }
     void Break() { mux_.Break(); }
@@ -0,0 +1,413 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "ip/posix/IoUring.h"
+
+#include <fcntl.h> // for O_CLOEXEC
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <signal.h> // for _NSIG
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring> // for memset
+
+
+static int io_uring_setup( unsigned entries, struct io_uring_params *params )
+{
+	return (int)syscall( __NR_io_uring_setup, entries, params );
+}
+
+static int io_uring_enter( int ring, unsigned toSubmit, unsigned minComplete,
+		unsigned flags, const void *arg, std::size_t argSize )
+{
+	return (int)syscall( __NR_io_uring_enter, ring, toSubmit, minComplete, flags, arg, argSize );
+}
+
+static int io_uring_register( int ring, unsigned opcode, const void *arg, unsigned count )
+{
+	return (int)syscall( __NR_io_uring_register, ring, opcode, arg, count );
+}
+
+
+IoUring::IoUring()
+	: ring_( -1 )
+	, ringMemory_( MAP_FAILED )
+	, ringMemorySize_( 0 )
+	, sqes_( 0 )
+	, sqesSize_( 0 )
+	, sqHead_( 0 )
+	, sqTail_( 0 )
+	, sqArray_( 0 )
+	, sqMask_( 0 )
+	, sqEntries_( 0 )
+	, sqLocalTail_( 0 )
+	, sqSubmitted_( 0 )
+	, cqHead_( 0 )
+	, cqTail_( 0 )
+	, cqMask_( 0 )
+	, cqes_( 0 )
+	, bufferRing_( 0 )
+	, bufferRingSize_( 0 )
+	, buffers_( 0 )
+	, buffersSize_( 0 )
+	, bufferCount_( 0 )
+	, bufferSize_( 0 )
+	, groupId_( 0 )
+	, bufferRingMapped_( false )
+	, bufferTail_( 0 )
+{
+}
+
+
+IoUring::~IoUring()
+{
+	Close();
+}
+
+
+void IoUring::Close()
+{
+	// the receive backend cancels its requests and waits for them to
+	// complete before returning from Run(), so nothing is writing into the
+	// buffers by the time they are unmapped here.
+	if( ring_ != -1 )
+		close( ring_ );
+	ring_ = -1;
+
+	if( bufferRing_ )
+		munmap( bufferRing_, bufferRingSize_ );
+	bufferRing_ = 0;
+
+	if( buffers_ )
+		munmap( buffers_, buffersSize_ );
+	buffers_ = 0;
+
+	if( sqes_ )
+		munmap( sqes_, sqesSize_ );
+	sqes_ = 0;
+
+	if( ringMemory_ != MAP_FAILED )
+		munmap( ringMemory_, ringMemorySize_ );
+	ringMemory_ = MAP_FAILED;
+}
+
+
+bool IoUring::Open( unsigned submissionEntries, unsigned completionEntries,
+		unsigned short groupId, unsigned bufferCount, unsigned bufferSize )
+{
+	Close();
+
+	struct io_uring_params params;
+	std::memset( &params, 0, sizeof(params) );
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = completionEntries;
+
+	ring_ = io_uring_setup( submissionEntries, &params );
+	if( ring_ < 0 ){
+		ring_ = -1;
+		return false;
+	}
+
+	// a single mmap for both rings (5.4) and waiting with a timeout (5.11)
+	if( !(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG) ){
+		Close();
+		return false;
+	}
+
+	std::size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	std::size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ringMemorySize_ = (sqSize > cqSize) ? sqSize : cqSize;
+	ringMemory_ = mmap( 0, ringMemorySize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQ_RING );
+	if( ringMemory_ == MAP_FAILED ){
+		Close();
+		return false;
+	}
+
+	sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+	void *sqes = mmap( 0, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQES );
+	if( sqes == MAP_FAILED ){
+		Close();
+		return false;
+	}
+	sqes_ = (struct io_uring_sqe*)sqes;
+
+	char *ring = (char*)ringMemory_;
+	sqHead_ = (unsigned*)( ring + params.sq_off.head );
+	sqTail_ = (unsigned*)( ring + params.sq_off.tail );
+	sqArray_ = (unsigned*)( ring + params.sq_off.array );
+	sqMask_ = *(unsigned*)( ring + params.sq_off.ring_mask );
+	sqEntries_ = params.sq_entries;
+	sqLocalTail_ = sqSubmitted_ = *sqTail_;
+
+	cqHead_ = (unsigned*)( ring + params.cq_off.head );
+	cqTail_ = (unsigned*)( ring + params.cq_off.tail );
+	cqMask_ = *(unsigned*)( ring + params.cq_off.ring_mask );
+	cqes_ = (struct io_uring_cqe*)( ring + params.cq_off.cqes );
+
+	// the provided buffer ring (5.19) must be page aligned, mmap takes care of that
+	bufferCount_ = bufferCount;
+	bufferSize_ = bufferSize;
+	bufferRingSize_ = bufferCount * sizeof(struct io_uring_buf);
+	void *bufferRing = mmap( 0, bufferRingSize_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+	if( bufferRing == MAP_FAILED ){
+		Close();
+		return false;
+	}
+	bufferRing_ = (struct io_uring_buf_ring*)bufferRing;
+
+	buffersSize_ = (std::size_t)bufferCount * bufferSize;
+	void *buffers = mmap( 0, buffersSize_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0 );
+	if( buffers == MAP_FAILED ){
+		Close();
+		return false;
+	}
+	buffers_ = (char*)buffers;
+
+	groupId_ = groupId;
+	recycled_.clear();
+	recycled_.reserve( bufferCount );
+
+	struct io_uring_buf_reg registration;
+	std::memset( &registration, 0, sizeof(registration) );
+	registration.ring_addr = (unsigned long long)bufferRing_;
+	registration.ring_entries = bufferCount;
+	registration.bgid = groupId;
+	bufferRingMapped_ = ( io_uring_register( ring_, IORING_REGISTER_PBUF_RING, &registration, 1 ) == 0 );
+
+	if( bufferRingMapped_ ){
+		bufferTail_ = 0;
+		for( unsigned i=0; i < bufferCount; ++i )
+			RecycleBuffer( (unsigned short)i );
+		PublishBuffers();
+
+		// some kernels accept the registration but then never select a
+		// buffer from the ring, so check that a read actually gets one
+		if( !ProbeBufferRing() ){
+			io_uring_register( ring_, IORING_UNREGISTER_PBUF_RING, &registration, 1 );
+			bufferRingMapped_ = false;
+		}
+	}
+
+	if( !bufferRingMapped_ ){
+		if( !ProvideBuffers( 0, bufferCount ) || Submit() != 0 ){
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool IoUring::ProbeBufferRing()
+{
+	int pipeFds[2];
+	if( pipe2( pipeFds, O_CLOEXEC ) != 0 )
+		return false;
+
+	bool works = false;
+	struct io_uring_sqe *sqe = GetSubmissionEntry();
+	if( sqe && write( pipeFds[1], "x", 1 ) == 1 ){
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = pipeFds[0];
+		sqe->off = (unsigned long long)-1;
+		sqe->len = 1;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = groupId_;
+		sqe->user_data = INTERNAL_USER_DATA;
+
+		struct io_uring_cqe cqe;
+		if( SubmitAndWait( -1 ) == 0 && PopAnyCompletion( cqe ) ){
+			works = ( cqe.res == 1 && (cqe.flags & IORING_CQE_F_BUFFER) );
+			if( cqe.flags & IORING_CQE_F_BUFFER ){
+				RecycleBuffer( (unsigned short)(cqe.flags >> IORING_CQE_BUFFER_SHIFT) );
+				PublishBuffers();
+			}
+		}
+	}
+
+	close( pipeFds[0] );
+	close( pipeFds[1] );
+	return works;
+}
+
+
+bool IoUring::ProvideBuffers( unsigned short firstBufferId, unsigned count )
+{
+	struct io_uring_sqe *sqe = GetSubmissionEntry();
+	if( !sqe && Submit() == 0 )
+		sqe = GetSubmissionEntry();
+	if( !sqe )
+		return false;
+
+	sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+	sqe->fd = (int)count;
+	sqe->addr = (unsigned long long)Buffer( firstBufferId );
+	sqe->len = bufferSize_;
+	sqe->off = firstBufferId;
+	sqe->buf_group = groupId_;
+	sqe->user_data = INTERNAL_USER_DATA;
+	return true;
+}
+
+
+struct io_uring_sqe *IoUring::GetSubmissionEntry()
+{
+	unsigned head = __atomic_load_n( sqHead_, __ATOMIC_ACQUIRE );
+	if( sqLocalTail_ - head >= sqEntries_ )
+		return 0;
+
+	unsigned index = sqLocalTail_ & sqMask_;
+	struct io_uring_sqe *sqe = &sqes_[ index ];
+	std::memset( sqe, 0, sizeof(*sqe) );
+	sqArray_[ index ] = index;
+	++sqLocalTail_;
+
+	return sqe;
+}
+
+
+int IoUring::Submit()
+{
+	unsigned pending = sqLocalTail_ - sqSubmitted_;
+	if( pending == 0 )
+		return 0;
+
+	__atomic_store_n( sqTail_, sqLocalTail_, __ATOMIC_RELEASE );
+
+	int result = io_uring_enter( ring_, pending, 0, 0, 0, 0 );
+	if( result < 0 )
+		return -errno;
+
+	sqSubmitted_ += (unsigned)result;
+	return 0;
+}
+
+
+int IoUring::SubmitAndWait( long long timeoutNs )
+{
+	unsigned pending = sqLocalTail_ - sqSubmitted_;
+	__atomic_store_n( sqTail_, sqLocalTail_, __ATOMIC_RELEASE );
+
+	struct __kernel_timespec timeout;
+	timeout.tv_sec = timeoutNs / 1000000000LL;
+	timeout.tv_nsec = timeoutNs % 1000000000LL;
+
+	struct io_uring_getevents_arg arg;
+	std::memset( &arg, 0, sizeof(arg) );
+	arg.sigmask_sz = _NSIG / 8;
+	arg.ts = (timeoutNs >= 0) ? (unsigned long long)&timeout : 0;
+
+	int result = io_uring_enter( ring_, pending, 1,
+			IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg) );
+	if( result < 0 ){
+		int error = errno;
+		return ( error == ETIME || error == EINTR ) ? 0 : -error;
+	}
+
+	sqSubmitted_ += (unsigned)result;
+	return 0;
+}
+
+
+bool IoUring::CompletionReady() const
+{
+	return *cqHead_ != __atomic_load_n( cqTail_, __ATOMIC_ACQUIRE );
+}
+
+
+bool IoUring::PopCompletion( struct io_uring_cqe& cqe )
+{
+	while( PopAnyCompletion( cqe ) ){
+		if( cqe.user_data != INTERNAL_USER_DATA )
+			return true;
+	}
+	return false;
+}
+
+
+bool IoUring::PopAnyCompletion( struct io_uring_cqe& cqe )
+{
+	unsigned head = *cqHead_;
+	if( head == __atomic_load_n( cqTail_, __ATOMIC_ACQUIRE ) )
+		return false;
+
+	cqe = cqes_[ head & cqMask_ ];
+	__atomic_store_n( cqHead_, head + 1, __ATOMIC_RELEASE );
+
+	return true;
+}
+
+
+void IoUring::RecycleBuffer( unsigned short bufferId )
+{
+	if( !bufferRingMapped_ ){
+		recycled_.push_back( bufferId );
+		return;
+	}
+
+	struct io_uring_buf *buffer = &bufferRing_->bufs[ bufferTail_ & (bufferCount_ - 1) ];
+	buffer->addr = (unsigned long long)Buffer( bufferId );
+	buffer->len = bufferSize_;
+	buffer->bid = bufferId;
+	++bufferTail_;
+}
+
+
+void IoUring::PublishBuffers()
+{
+	if( bufferRingMapped_ ){
+		__atomic_store_n( &bufferRing_->tail, bufferTail_, __ATOMIC_RELEASE );
+		return;
+	}
+
+	// one provide buffers request per run of consecutive buffer ids
+	std::sort( recycled_.begin(), recycled_.end() );
+	std::size_t i = 0;
+	while( i < recycled_.size() ){
+		std::size_t j = i + 1;
+		while( j < recycled_.size() && recycled_[j] == recycled_[j - 1] + 1 )
+			++j;
+
+		if( !ProvideBuffers( recycled_[i], (unsigned)(j - i) ) )
+			break; // the submission queue is full, try again next time
+		i = j;
+	}
+	recycled_.erase( recycled_.begin(), recycled_.begin() + i );
+}
@@ -0,0 +1,138 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_IOURING_H
+#define INCLUDED_OSCPACK_IOURING_H
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <vector>
+
+
+// minimal io_uring wrapper for the io_uring receive backend of
+// SocketReceiveMultiplexer. it talks to the kernel through the raw
+// syscalls so there is no dependency on liburing.
+//
+// one submission/completion ring pair plus one group of provided buffers
+// which the kernel picks receive buffers from (IOSQE_BUFFER_SELECT). the
+// buffers are handed to the kernel through a registered buffer ring, or
+// with IORING_OP_PROVIDE_BUFFERS requests where the buffer ring doesn't
+// work. the class is not thread safe, everything happens on the thread
+// calling Run().
+
+class IoUring{
+    int ring_;
+
+    void *ringMemory_;
+    std::size_t ringMemorySize_;
+    struct io_uring_sqe *sqes_;
+    std::size_t sqesSize_;
+
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned *sqArray_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned sqLocalTail_;  // entries handed out by GetSubmissionEntry()
+    unsigned sqSubmitted_;  // entries passed to the kernel
+
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    struct io_uring_cqe *cqes_;
+
+    struct io_uring_buf_ring *bufferRing_;
+    std::size_t bufferRingSize_;
+    char *buffers_;
+    std::size_t buffersSize_;
+    unsigned bufferCount_;
+    unsigned bufferSize_;
+    unsigned short groupId_;
+    bool bufferRingMapped_;
+    unsigned short bufferTail_;      // buffer ring mode
+    std::vector< unsigned short > recycled_; // IORING_OP_PROVIDE_BUFFERS mode
+
+    // user_data of completions which are consumed internally
+    static const unsigned long long INTERNAL_USER_DATA = ~0ULL - 16;
+
+    void Close();
+    bool PopAnyCompletion( struct io_uring_cqe& cqe );
+    bool ProbeBufferRing();
+    bool ProvideBuffers( unsigned short firstBufferId, unsigned count );
+
+public:
+    IoUring();
+    ~IoUring();
+
+    // set up the rings and a provided buffer ring of bufferCount buffers
+    // (a power of two) of bufferSize bytes each, in buffer group groupId.
+    // returns false, leaving the object closed, if the kernel doesn't
+    // support the io_uring features that are needed.
+    bool Open( unsigned submissionEntries, unsigned completionEntries,
+            unsigned short groupId, unsigned bufferCount, unsigned bufferSize );
+    bool IsOpen() const { return ring_ != -1; }
+
+    // 0 when the submission queue is full, Submit() and try again
+    struct io_uring_sqe *GetSubmissionEntry();
+
+    // pass pending submissions to the kernel without waiting.
+    // returns 0 or -errno.
+    int Submit();
+
+    // pass pending submissions and wait for at least one completion, or
+    // until timeoutNs elapses (negative waits indefinitely). returns 0 on
+    // a completion or timeout, otherwise -errno.
+    int SubmitAndWait( long long timeoutNs );
+
+    bool CompletionReady() const;
+
+    // copy the oldest completion into cqe and retire it.
+    // returns false if there are none. completions of the requests
+    // issued by this class are skipped.
+    bool PopCompletion( struct io_uring_cqe& cqe );
+
+    char *Buffer( unsigned short bufferId ) { return buffers_ + (std::size_t)bufferId * bufferSize_; }
+    unsigned BufferSize() const { return bufferSize_; }
+
+    // hand a buffer back to the kernel. the buffers become visible to the
+    // kernel on the next call to PublishBuffers() (buffer ring), or the next
+    // submission after it (provide buffers requests).
+    void RecycleBuffer( unsigned short bufferId );
+    void PublishBuffers();
+};
+
+#endif /* INCLUDED_OSCPACK_IOURING_H */
@@ -0,0 +1,1696 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "ip/UdpSocket.h"
+
+// the receive paths use epoll, eventfd, recvmmsg and the sock_diag memory
+// counters, so this implementation builds on Linux only.
+#if !defined(__linux__)
+#error "ip/posix/UdpSocket.cpp requires Linux"
+#endif
+
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/sock_diag.h> // for SK_MEMINFO_*
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h> // for sockaddr_in
+#include <poll.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstring> // for memset
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "ip/PacketListener.h"
+#include "ip/TimerListener.h"
+#include "ip/TimerQueue.h"
+#include "ip/posix/IoUring.h"
+
+
+static void SockaddrFromIpEndpointName( struct sockaddr_in& sockAddr, const IpEndpointName& endpoint )
+{
+    std::memset( (char *)&sockAddr, 0, sizeof(sockAddr ) );
+    sockAddr.sin_family = AF_INET;
+
+	sockAddr.sin_addr.s_addr = 
+		(endpoint.address == IpEndpointName::ANY_ADDRESS)
+		? INADDR_ANY
+		: htonl( endpoint.address );
+
+	sockAddr.sin_port =
+		(endpoint.port == IpEndpointName::ANY_PORT)
+		? 0
+		: htons( endpoint.port );
+}
+
+
+static IpEndpointName IpEndpointNameFromSockaddr( const struct sockaddr_in& sockAddr )
+{
+	return IpEndpointName( 
+		(sockAddr.sin_addr.s_addr == INADDR_ANY) 
+			? IpEndpointName::ANY_ADDRESS 
+			: ntohl( sockAddr.sin_addr.s_addr ),
+		(sockAddr.sin_port == 0)
+			? IpEndpointName::ANY_PORT
+			: ntohs( sockAddr.sin_port )
+		);
+}
+
+
+static struct in_addr InAddrFromAddress( unsigned long address )
+{
+	struct in_addr result;
+	result.s_addr = 
+		(address == IpEndpointName::ANY_ADDRESS)
+		? INADDR_ANY
+		: htonl( address );
+	return result;
+}
+
+
+static void MulticastRequestFor( struct ip_mreq& request, const IpEndpointName& group, unsigned long interfaceAddress )
+{
+	std::memset( &request, 0, sizeof(request) );
+	request.imr_multiaddr.s_addr = htonl( group.address );
+	request.imr_interface = InAddrFromAddress( interfaceAddress );
+}
+
+
+static void SetNonBlocking( int fd, bool nonBlocking )
+{
+	int flags = fcntl( fd, F_GETFL, 0 );
+	if( flags < 0 )
+		return;
+
+	flags = (nonBlocking) ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+	fcntl( fd, F_SETFL, flags );
+}
+
+
+class UdpSocket::Implementation{
+	bool isBound_;
+	bool isConnected_;
+	bool receiveTimestamps_;
+	bool dropCounting_;
+	uint32_t lastDropCount_; // only touched by the receiving thread
+
+	int socket_;
+	struct sockaddr_in connectedAddr_;
+	struct sockaddr_in sendToAddr_;
+
+public:
+
+	Implementation()
+		: isBound_( false )
+		, isConnected_( false )
+		, receiveTimestamps_( false )
+		, dropCounting_( false )
+		, lastDropCount_( 0 )
+		, socket_( -1 )
+	{
+		if( (socket_ = socket( AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0 )) == -1 ){
+            throw std::runtime_error("unable to create udp socket\n");
+        }
+
+		std::memset( &sendToAddr_, 0, sizeof(sendToAddr_) );
+        sendToAddr_.sin_family = AF_INET;
+	}
+
+	~Implementation()
+	{
+		if (socket_ != -1) close(socket_);
+	}
+
+	void SetEnableBroadcast( bool enableBroadcast )
+	{
+		int broadcast = (enableBroadcast) ? 1 : 0; // int on posix
+		setsockopt(socket_, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+	}
+
+	void SetAllowReuse( bool allowReuse )
+	{
+		int reuseAddr = (allowReuse) ? 1 : 0; // int on posix
+		setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
+	}
+
+	bool SetAllowReusePort( bool allowReusePort )
+	{
+#ifdef SO_REUSEPORT
+		int reusePort = (allowReusePort) ? 1 : 0; // int on posix
+		return setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort)) == 0;
+#else
+		(void)allowReusePort;
+		return false;
+#endif
+	}
+
+	void SetEnableReceiveTimestamps( bool enableReceiveTimestamps )
+	{
+		int timestamps = (enableReceiveTimestamps) ? 1 : 0; // int on posix
+		if( setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPNS, &timestamps, sizeof(timestamps)) == 0 )
+			receiveTimestamps_ = enableReceiveTimestamps;
+	}
+
+	bool ReceiveTimestamps() const { return receiveTimestamps_; }
+
+	int SetBufferSize( int option, int forceOption, int size )
+	{
+		// the force variant ignores the sysctl limit but needs CAP_NET_ADMIN
+		if( setsockopt(socket_, SOL_SOCKET, forceOption, &size, sizeof(size)) < 0 )
+			setsockopt(socket_, SOL_SOCKET, option, &size, sizeof(size));
+		return BufferSize( option );
+	}
+
+	int BufferSize( int option ) const
+	{
+		int size = 0;
+		socklen_t length = sizeof(size);
+		if( getsockopt(socket_, SOL_SOCKET, option, &size, &length) < 0 )
+			return 0;
+		return size;
+	}
+
+	int SetReceiveBufferSize( int size ) { return SetBufferSize( SO_RCVBUF, SO_RCVBUFFORCE, size ); }
+	int SetSendBufferSize( int size ) { return SetBufferSize( SO_SNDBUF, SO_SNDBUFFORCE, size ); }
+	int ReceiveBufferSize() const { return BufferSize( SO_RCVBUF ); }
+	int SendBufferSize() const { return BufferSize( SO_SNDBUF ); }
+
+	bool SetEnableDropCounting( bool enableDropCounting )
+	{
+#ifdef SO_RXQ_OVFL
+		int dropCounting = (enableDropCounting) ? 1 : 0; // int on posix
+		if( setsockopt(socket_, SOL_SOCKET, SO_RXQ_OVFL, &dropCounting, sizeof(dropCounting)) < 0 )
+			return false;
+		dropCounting_ = enableDropCounting;
+		return true;
+#else
+		(void)enableDropCounting;
+		return false;
+#endif
+	}
+
+	bool DropCounting() const { return dropCounting_; }
+
+	// whether received datagrams carry ancillary data we read
+	bool ReceiveControl() const { return receiveTimestamps_ || dropCounting_; }
+
+	// takes the running drop count attached to a datagram and returns how
+	// many drops it adds since the last one seen
+	uint32_t AdvanceDropCount( uint32_t dropCount )
+	{
+		uint32_t dropped = dropCount - lastDropCount_; // the counter wraps
+		lastDropCount_ = dropCount;
+		return dropped;
+	}
+
+	void JoinMulticastGroup( const IpEndpointName& group, unsigned long interfaceAddress )
+	{
+		struct ip_mreq request;
+		MulticastRequestFor( request, group, interfaceAddress );
+
+		if( setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) < 0 ){
+			throw std::runtime_error("unable to join multicast group\n");
+		}
+
+#ifdef IP_MULTICAST_ALL
+		// only deliver the groups joined on this socket, by default linux
+		// delivers every group any socket on the host has joined
+		int multicastAll = 0; // int on posix
+		setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_ALL, &multicastAll, sizeof(multicastAll));
+#endif
+	}
+
+	void LeaveMulticastGroup( const IpEndpointName& group, unsigned long interfaceAddress )
+	{
+		struct ip_mreq request;
+		MulticastRequestFor( request, group, interfaceAddress );
+
+		setsockopt(socket_, IPPROTO_IP, IP_DROP_MEMBERSHIP, &request, sizeof(request));
+	}
+
+	void SetMulticastInterface( unsigned long interfaceAddress )
+	{
+		struct in_addr address = InAddrFromAddress( interfaceAddress );
+		setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, &address, sizeof(address));
+	}
+
+	void SetMulticastTimeToLive( int timeToLive )
+	{
+		unsigned char ttl = (unsigned char)((timeToLive < 0) ? 0 : (timeToLive > 255) ? 255 : timeToLive);
+		setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+	}
+
+	void SetEnableMulticastLoopback( bool enableLoopback )
+	{
+		unsigned char loop = (unsigned char)((enableLoopback) ? 1 : 0);
+		setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+	}
+
+	IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
+	{
+		assert( isBound_ );
+
+		// first connect the socket to the remote server
+        
+        struct sockaddr_in connectSockAddr;
+		SockaddrFromIpEndpointName( connectSockAddr, remoteEndpoint );
+       
+        if (connect(socket_, (struct sockaddr *)&connectSockAddr, sizeof(connectSockAddr)) < 0) {
+            throw std::runtime_error("unable to connect udp socket\n");
+        }
+
+        // get the address
+
+        struct sockaddr_in sockAddr;
+        std::memset( (char *)&sockAddr, 0, sizeof(sockAddr ) );
+        socklen_t length = sizeof(sockAddr);
+        if (getsockname(socket_, (struct sockaddr *)&sockAddr, &length) < 0) {
+            throw std::runtime_error("unable to getsockname\n");
+        }
+        
+		if( isConnected_ ){
+			// reconnect to the connected address
+			
+			if (connect(socket_, (struct sockaddr *)&connectedAddr_, sizeof(connectedAddr_)) < 0) {
+				throw std::runtime_error("unable to connect udp socket\n");
+			}
+
+		}else{
+			// unconnect from the remote address
+		
+			struct sockaddr_in unconnectSockAddr;
+			std::memset( (char *)&unconnectSockAddr, 0, sizeof(unconnectSockAddr ) );
+			unconnectSockAddr.sin_family = AF_UNSPEC;
+			// address fields are zero
+			int connectResult = connect(socket_, (struct sockaddr *)&unconnectSockAddr, sizeof(unconnectSockAddr));
+			if ( connectResult < 0 && errno != EAFNOSUPPORT ) {
+				throw std::runtime_error("unable to un-connect udp socket\n");
+			}
+		}
+
+		return IpEndpointNameFromSockaddr( sockAddr );
+	}
+
+	void Connect( const IpEndpointName& remoteEndpoint )
+	{
+		SockaddrFromIpEndpointName( connectedAddr_, remoteEndpoint );
+       
+        if (connect(socket_, (struct sockaddr *)&connectedAddr_, sizeof(connectedAddr_)) < 0) {
+            throw std::runtime_error("unable to connect udp socket\n");
+        }
+
+		isConnected_ = true;
+	}
+
+	void Send( const char *data, std::size_t size )
+	{
+		assert( isConnected_ );
+
+        send( socket_, data, size, 0 );
+	}
+
+    void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+	{
+		sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
+        sendToAddr_.sin_port = htons( remoteEndpoint.port );
+
+        sendto( socket_, data, size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
+	}
+
+	std::size_t SendMultiple( const OutgoingDatagram *datagrams, std::size_t count )
+	{
+		enum { MAX_MESSAGES_PER_CALL = 64 };
+		struct mmsghdr messages[ MAX_MESSAGES_PER_CALL ];
+		struct iovec iovecs[ MAX_MESSAGES_PER_CALL ];
+		struct sockaddr_in addresses[ MAX_MESSAGES_PER_CALL ];
+
+		std::size_t sent = 0;
+		while( sent < count ){
+			std::size_t n = count - sent;
+			if( n > MAX_MESSAGES_PER_CALL )
+				n = MAX_MESSAGES_PER_CALL;
+
+			std::memset( messages, 0, n * sizeof(struct mmsghdr) );
+			for( std::size_t i=0; i < n; ++i ){
+				const OutgoingDatagram& datagram = datagrams[ sent + i ];
+				SockaddrFromIpEndpointName( addresses[i], datagram.remoteEndpoint );
+				iovecs[i].iov_base = const_cast<char*>( datagram.data );
+				iovecs[i].iov_len = datagram.size;
+				messages[i].msg_hdr.msg_name = &addresses[i];
+				messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+				messages[i].msg_hdr.msg_iov = &iovecs[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			int result = sendmmsg( socket_, messages, (unsigned int)n, 0 );
+			if( result < 0 && errno == EINTR )
+				continue;
+			if( result <= 0 )
+				break;
+
+			sent += (std::size_t)result;
+		}
+
+		return sent;
+	}
+
+	void Bind( const IpEndpointName& localEndpoint )
+	{
+		struct sockaddr_in bindSockAddr;
+		SockaddrFromIpEndpointName( bindSockAddr, localEndpoint );
+
+        if (bind(socket_, (struct sockaddr *)&bindSockAddr, sizeof(bindSockAddr)) < 0) {
+            throw std::runtime_error("unable to bind udp socket\n");
+        }
+
+		isBound_ = true;
+	}
+
+	bool IsBound() const { return isBound_; }
+
+    std::size_t ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size )
+	{
+		assert( isBound_ );
+
+		struct sockaddr_in fromAddr;
+        socklen_t fromAddrLen = sizeof(fromAddr);
+             	 
+        ssize_t result = recvfrom(socket_, data, size, 0,
+                    (struct sockaddr *) &fromAddr, (socklen_t*)&fromAddrLen);
+		if( result < 0 )
+			return 0;
+
+		remoteEndpoint.address = ntohl(fromAddr.sin_addr.s_addr);
+		remoteEndpoint.port = ntohs(fromAddr.sin_port);
+
+		return (std::size_t)result;
+	}
+
+	// receive up to count datagrams without blocking. returns the number of
+	// datagrams received, or 0 if none were pending.
+	int ReceiveMultiple( struct mmsghdr *messages, int count )
+	{
+		assert( isBound_ );
+
+		int result = recvmmsg( socket_, messages, (unsigned int)count, MSG_DONTWAIT, 0 );
+		if( result < 0 )
+			return 0;
+
+		return result;
+	}
+
+	std::size_t ReceiveQueueBytes() const
+	{
+#ifdef SO_MEMINFO
+		uint32_t meminfo[ SK_MEMINFO_VARS ];
+		socklen_t length = sizeof(meminfo);
+		if( getsockopt( socket_, SOL_SOCKET, SO_MEMINFO, meminfo, &length ) == 0 )
+			return meminfo[ SK_MEMINFO_RMEM_ALLOC ];
+#endif
+		// FIONREAD only reports the size of the next datagram for udp on linux
+		int pending = 0;
+		if( ioctl( socket_, FIONREAD, &pending ) < 0 )
+			return 0;
+
+		return (std::size_t)pending;
+	}
+
+	int Socket() { return socket_; }
+};
+
+UdpSocket::UdpSocket()
+{
+	impl_ = new Implementation();
+}
+
+UdpSocket::~UdpSocket()
+{
+	delete impl_;
+}
+
+void UdpSocket::SetEnableBroadcast( bool enableBroadcast )
+{
+    impl_->SetEnableBroadcast( enableBroadcast );
+}
+
+void UdpSocket::SetAllowReuse( bool allowReuse )
+{
+    impl_->SetAllowReuse( allowReuse );
+}
+
+bool UdpSocket::SetAllowReusePort( bool allowReusePort )
+{
+    return impl_->SetAllowReusePort( allowReusePort );
+}
+
+void UdpSocket::SetEnableReceiveTimestamps( bool enableReceiveTimestamps )
+{
+    impl_->SetEnableReceiveTimestamps( enableReceiveTimestamps );
+}
+
+int UdpSocket::SetReceiveBufferSize( int size )
+{
+	return impl_->SetReceiveBufferSize( size );
+}
+
+int UdpSocket::SetSendBufferSize( int size )
+{
+	return impl_->SetSendBufferSize( size );
+}
+
+int UdpSocket::ReceiveBufferSize() const
+{
+	return impl_->ReceiveBufferSize();
+}
+
+int UdpSocket::SendBufferSize() const
+{
+	return impl_->SendBufferSize();
+}
+
+bool UdpSocket::SetEnableDropCounting( bool enableDropCounting )
+{
+	return impl_->SetEnableDropCounting( enableDropCounting );
+}
+
+void UdpSocket::JoinMulticastGroup( const IpEndpointName& group, unsigned long interfaceAddress )
+{
+	impl_->JoinMulticastGroup( group, interfaceAddress );
+}
+
+void UdpSocket::LeaveMulticastGroup( const IpEndpointName& group, unsigned long interfaceAddress )
+{
+	impl_->LeaveMulticastGroup( group, interfaceAddress );
+}
+
+void UdpSocket::SetMulticastInterface( unsigned long interfaceAddress )
+{
+	impl_->SetMulticastInterface( interfaceAddress );
+}
+
+void UdpSocket::SetMulticastTimeToLive( int timeToLive )
+{
+	impl_->SetMulticastTimeToLive( timeToLive );
+}
+
+void UdpSocket::SetEnableMulticastLoopback( bool enableLoopback )
+{
+	impl_->SetEnableMulticastLoopback( enableLoopback );
+}
+
+IpEndpointName UdpSocket::LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
+{
+	return impl_->LocalEndpointFor( remoteEndpoint );
+}
+
+void UdpSocket::Connect( const IpEndpointName& remoteEndpoint )
+{
+	impl_->Connect( remoteEndpoint );
+}
+
+void UdpSocket::Send( const char *data, std::size_t size )
+{
+	impl_->Send( data, size );
+}
+
+void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+{
+	impl_->SendTo( remoteEndpoint, data, size );
+}
+
+std::size_t UdpSocket::SendMultiple( const OutgoingDatagram *datagrams, std::size_t count )
+{
+	return impl_->SendMultiple( datagrams, count );
+}
+
+void UdpSocket::Bind( const IpEndpointName& localEndpoint )
+{
+	impl_->Bind( localEndpoint );
+}
+
+bool UdpSocket::IsBound() const
+{
+	return impl_->IsBound();
+}
+
+std::size_t UdpSocket::ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size )
+{
+	return impl_->ReceiveFrom( remoteEndpoint, data, size );
+}
+
+std::size_t UdpSocket::ReceiveQueueBytes() const
+{
+	return impl_->ReceiveQueueBytes();
+}
+
+
+static long long TimespecToNs( const struct timespec& t )
+{
+	return (long long)t.tv_sec * 1000000000LL + (long long)t.tv_nsec;
+}
+
+
+static long long MonotonicTimeNs()
+{
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+
+	return TimespecToNs( t );
+}
+
+
+// kernel timestamps are CLOCK_REALTIME, listeners expect steady_clock
+// which is CLOCK_MONOTONIC on linux. returns realtime - monotonic now.
+static long long RealtimeToMonotonicOffsetNs()
+{
+	struct timespec realtime, monotonic;
+	clock_gettime( CLOCK_REALTIME, &realtime );
+	clock_gettime( CLOCK_MONOTONIC, &monotonic );
+
+	return TimespecToNs( realtime ) - TimespecToNs( monotonic );
+}
+
+
+// room for the ancillary data that carries a receive timestamp and a drop
+// count, CMSG_SPACE() of a timespec and a uint32_t
+static const std::size_t RECEIVE_CONTROL_SIZE = 64;
+
+
+// the SO_TIMESTAMPNS receive time in a received message header converted to
+// steady_clock, or fallbackNs if the kernel didn't attach one
+static long long ArrivalTimeNs( struct msghdr *header, long long realtimeToMonotonicNs, long long fallbackNs )
+{
+	for( struct cmsghdr *c = CMSG_FIRSTHDR( header ); c != 0; c = CMSG_NXTHDR( header, c ) ){
+		if( c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS ){
+			struct timespec t;
+			std::memcpy( &t, CMSG_DATA( c ), sizeof(t) );
+			return TimespecToNs( t ) - realtimeToMonotonicNs;
+		}
+	}
+	return fallbackNs;
+}
+
+
+// the SO_RXQ_OVFL count of datagrams the socket has dropped so far. the
+// kernel only attaches it once something was dropped.
+static bool ReceivedDropCount( struct msghdr *header, uint32_t& dropCount )
+{
+#ifdef SO_RXQ_OVFL
+	for( struct cmsghdr *c = CMSG_FIRSTHDR( header ); c != 0; c = CMSG_NXTHDR( header, c ) ){
+		if( c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL ){
+			std::memcpy( &dropCount, CMSG_DATA( c ), sizeof(dropCount) );
+			return true;
+		}
+	}
+#else
+	(void)header;
+	(void)dropCount;
+#endif
+	return false;
+}
+
+
+// preallocated storage for one batch of datagrams received with recvmmsg().
+// each datagram gets its own fixed size slot in a single contiguous slab,
+// plus room for the ancillary data that carries its receive timestamp.
+class ReceiveSlab{
+	std::size_t slotSize_;
+	std::vector< char > data_;
+	std::vector< struct mmsghdr > messages_;
+	std::vector< struct iovec > iovecs_;
+	std::vector< struct sockaddr_in > addresses_;
+	std::vector< struct cmsghdr > control_; // cmsghdr elements keep the control buffers aligned
+
+public:
+	ReceiveSlab( int slotCount, std::size_t slotSize )
+		: slotSize_( slotSize )
+		, data_( slotCount * slotSize )
+		, messages_( slotCount )
+		, iovecs_( slotCount )
+		, addresses_( slotCount )
+		, control_( slotCount * ControlElementsPerSlot() )
+	{
+		for( int i=0; i < slotCount; ++i ){
+			iovecs_[i].iov_base = &data_[ i * slotSize_ ];
+			iovecs_[i].iov_len = slotSize_;
+
+			std::memset( &messages_[i], 0, sizeof(messages_[i]) );
+			messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+			messages_[i].msg_hdr.msg_iovlen = 1;
+			messages_[i].msg_hdr.msg_name = &addresses_[i];
+		}
+	}
+
+	int SlotCount() const { return (int)messages_.size(); }
+
+	// must be called before each receive, the kernel overwrites the name
+	// and control lengths
+	struct mmsghdr *Prepare( int count, bool withControl )
+	{
+		for( int i=0; i < count; ++i ){
+			messages_[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			messages_[i].msg_hdr.msg_control = (withControl) ? &control_[ i * ControlElementsPerSlot() ] : 0;
+			messages_[i].msg_hdr.msg_controllen = (withControl) ? RECEIVE_CONTROL_SIZE : 0;
+			messages_[i].msg_hdr.msg_flags = 0;
+			messages_[i].msg_len = 0;
+		}
+		return &messages_[0];
+	}
+
+	long long ArrivalTimeNs( int i, long long realtimeToMonotonicNs, long long fallbackNs )
+	{
+		return ::ArrivalTimeNs( &messages_[i].msg_hdr, realtimeToMonotonicNs, fallbackNs );
+	}
+
+	bool DropCount( int i, uint32_t& dropCount )
+	{
+		return ReceivedDropCount( &messages_[i].msg_hdr, dropCount );
+	}
+
+	const char *Data( int i ) const { return &data_[ i * slotSize_ ]; }
+	std::size_t Size( int i ) const { return messages_[i].msg_len; }
+
+	// the datagram didn't fit its slot and was cut short
+	bool Truncated( int i ) const { return (messages_[i].msg_hdr.msg_flags & MSG_TRUNC) != 0; }
+
+	void RemoteEndpoint( int i, IpEndpointName& remoteEndpoint ) const
+	{
+		remoteEndpoint.address = ntohl( addresses_[i].sin_addr.s_addr );
+		remoteEndpoint.port = ntohs( addresses_[i].sin_port );
+	}
+
+private:
+	static std::size_t ControlElementsPerSlot()
+	{
+		return (RECEIVE_CONTROL_SIZE + sizeof(struct cmsghdr) - 1) / sizeof(struct cmsghdr);
+	}
+};
+
+
+struct AttachedTimerListener{
+	AttachedTimerListener( unsigned long long i, long long d, long long p, TimerListener *tl )
+		: id( i )
+		, initialDelayNs( d )
+		, periodNs( p )
+		, listener( tl ) {}
+	unsigned long long id;
+	long long initialDelayNs;
+	long long periodNs;
+	TimerListener *listener;
+};
+
+
+SocketReceiveMultiplexer *multiplexerInstanceToAbortWithSigInt_ = 0;
+
+extern "C" /*static*/ void InterruptSignalHandler( int );
+/*static*/ void InterruptSignalHandler( int )
+{
+	multiplexerInstanceToAbortWithSigInt_->AsynchronousBreak();
+    signal( SIGINT, SIG_DFL );
+}
+
+
+class SocketReceiveMultiplexer::Implementation{
+	std::vector< std::pair< PacketListener*, UdpSocket* > > socketListeners_;
+	std::vector< AttachedTimerListener > timerListeners_;
+
+	// timerMutex_ guards the timer state so that timers can be attached and
+	// detached while Run() is active. Run() holds it while calling
+	// TimerExpired(): it is recursive so that a listener can detach itself,
+	// and a detach from another thread returns only once the call is over.
+	mutable std::recursive_mutex timerMutex_;
+	TimerQueue timerQueue_;
+	unsigned long long nextTimerId_;
+	bool running_;
+
+	// set by AsynchronousBreak() from other threads. it is cleared when a
+	// run ends, so a break that comes before Run() still ends that run.
+	std::atomic< bool > break_;
+	bool drainUntilEmpty_;
+	int drainBudget_;
+	int receiveBatchSize_;
+	bool busyPoll_;
+	long long busyPollIdleNs_;
+
+	std::atomic< unsigned long long > wakeups_;
+	std::atomic< unsigned long long > batches_;
+	std::atomic< unsigned long long > datagrams_;
+	std::atomic< unsigned int > maxBatchDepth_;
+	std::atomic< unsigned long long > drainBudgetExhausted_;
+	std::atomic< unsigned long long > kernelDrops_;
+	std::atomic< unsigned long long > truncatedDatagrams_;
+	std::atomic< unsigned long long > maxReceiveQueueBytes_;
+	std::atomic< unsigned long long > spinPolls_;
+	std::atomic< unsigned long long > spinPollsWithData_;
+	std::atomic< unsigned long long > blockingWaits_;
+	std::atomic< unsigned long long > wakeToDispatch_[ SocketReceiveStatistics::LATENCY_BUCKETS ];
+
+	// the epoll instance is created once and the sockets are (re)registered
+	// on every call to Run(). breakEvent_ is an eventfd which is always
+	// registered, it is what AsynchronousBreak() signals to wake epoll_wait().
+	int epoll_;
+	int breakEvent_;
+
+	// the io_uring backend keeps its rings and provided receive buffers for
+	// the lifetime of the multiplexer. a datagram, its source address and
+	// its timestamp must fit into one buffer.
+	enum {
+		IO_URING_SUBMISSION_ENTRIES = 64,
+		IO_URING_COMPLETION_ENTRIES = 1024,
+		IO_URING_BUFFER_GROUP = 0,
+		IO_URING_BUFFER_COUNT = 512,
+		IO_URING_BUFFER_SIZE = 4352
+	};
+	static const unsigned long long IO_URING_BREAK = ~0ULL;
+	static const unsigned long long IO_URING_CANCEL = ~0ULL - 1;
+
+	SocketReceiveBackend backend_;
+	IoUring ioUring_;
+
+	long long GetCurrentTimeNs() const
+	{
+		return MonotonicTimeNs();
+	}
+
+	// wake epoll_wait() so the loop rechecks break_ and the timer queue
+	void Wake()
+	{
+		uint64_t value = 1;
+		ssize_t bytes = write( breakEvent_, &value, sizeof(value) );
+		(void)bytes;
+	}
+
+	// nanoseconds until the next timer is due, -1 (infinite) when there are
+	// no timers
+	long long TimerWaitNs() const
+	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+		if( timerQueue_.Empty() )
+			return -1;
+
+		long long remainingNs = timerQueue_.NextDeadlineNs() - GetCurrentTimeNs();
+		return (remainingNs > 0) ? remainingNs : 0;
+	}
+
+	// as TimerWaitNs() but rounded up to milliseconds so that we don't wake
+	// before the timer is due
+	int TimerWaitMs() const
+	{
+		long long remainingNs = TimerWaitNs();
+		if( remainingNs < 0 )
+			return -1;
+
+		long long ms = (remainingNs + 999999) / 1000000;
+		return (ms < INT_MAX) ? (int)ms : INT_MAX;
+	}
+
+	void RecordBatch( int received )
+	{
+		batches_.fetch_add( 1, std::memory_order_relaxed );
+		datagrams_.fetch_add( (unsigned long long)received, std::memory_order_relaxed );
+		if( (unsigned int)received > maxBatchDepth_.load( std::memory_order_relaxed ) )
+			maxBatchDepth_.store( (unsigned int)received, std::memory_order_relaxed );
+	}
+
+	void RecordDispatchLatency( long long wakeTimeNs )
+	{
+		int bucket = SocketReceiveStatistics::LatencyBucket( GetCurrentTimeNs() - wakeTimeNs );
+		wakeToDispatch_[bucket].fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	void RecordKernelDrops( UdpSocket *socket, uint32_t dropCount )
+	{
+		uint32_t dropped = socket->impl_->AdvanceDropCount( dropCount );
+		if( dropped > 0 )
+			kernelDrops_.fetch_add( dropped, std::memory_order_relaxed );
+	}
+
+	void RecordTruncated()
+	{
+		truncatedDatagrams_.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	void RecordDrainBudgetExhausted( UdpSocket *socket )
+	{
+		drainBudgetExhausted_.fetch_add( 1, std::memory_order_relaxed );
+
+		unsigned long long queued = socket->ReceiveQueueBytes();
+		if( queued > maxReceiveQueueBytes_.load( std::memory_order_relaxed ) )
+			maxReceiveQueueBytes_.store( queued, std::memory_order_relaxed );
+	}
+
+public:
+    Implementation( SocketReceiveBackend backend )
+		: nextTimerId_( 0 )
+		, running_( false )
+		, break_( false )
+		, drainUntilEmpty_( false )
+		, drainBudget_( 256 )
+		, receiveBatchSize_( 1 )
+		, busyPoll_( false )
+		, busyPollIdleNs_( -1 )
+		, wakeups_( 0 )
+		, batches_( 0 )
+		, datagrams_( 0 )
+		, maxBatchDepth_( 0 )
+		, drainBudgetExhausted_( 0 )
+		, kernelDrops_( 0 )
+		, truncatedDatagrams_( 0 )
+		, maxReceiveQueueBytes_( 0 )
+		, spinPolls_( 0 )
+		, spinPollsWithData_( 0 )
+		, blockingWaits_( 0 )
+		, backend_( backend )
+	{
+		for( int i=0; i < SocketReceiveStatistics::LATENCY_BUCKETS; ++i )
+			wakeToDispatch_[i].store( 0, std::memory_order_relaxed );
+
+		if( (epoll_ = epoll_create1( EPOLL_CLOEXEC )) == -1 ){
+			throw std::runtime_error("unable to create epoll instance\n");
+		}
+
+		if( (breakEvent_ = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC )) == -1 ){
+			close( epoll_ );
+			throw std::runtime_error("unable to create break eventfd\n");
+		}
+
+		if( backend_ == IO_URING_RECEIVE_BACKEND
+				&& !ioUring_.Open( IO_URING_SUBMISSION_ENTRIES, IO_URING_COMPLETION_ENTRIES,
+						IO_URING_BUFFER_GROUP, IO_URING_BUFFER_COUNT, IO_URING_BUFFER_SIZE ) )
+			backend_ = WAIT_RECEIVE_BACKEND; // the kernel is too old
+	}
+
+	SocketReceiveBackend Backend() const { return backend_; }
+
+    ~Implementation()
+	{
+		close( breakEvent_ );
+		close( epoll_ );
+	}
+
+    void AttachSocketListener( UdpSocket *socket, PacketListener *listener )
+	{
+		assert( std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) ) == socketListeners_.end() );
+		// we don't check that the same socket has been added multiple times, even though this is an error
+		socketListeners_.push_back( std::make_pair( listener, socket ) );
+	}
+
+    void DetachSocketListener( UdpSocket *socket, PacketListener *listener )
+	{
+		std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = 
+				std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) );
+		assert( i != socketListeners_.end() );
+
+		socketListeners_.erase( i );
+	}
+
+    void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
+	{
+		AttachPeriodicTimerListener( periodMilliseconds, periodMilliseconds, listener );
+	}
+
+	void AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
+	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+
+		AttachedTimerListener timer( nextTimerId_++,
+				(long long)initialDelayMilliseconds * 1000000, (long long)periodMilliseconds * 1000000, listener );
+		timerListeners_.push_back( timer );
+
+		if( running_ ){
+			timerQueue_.Schedule( timer.id, GetCurrentTimeNs() + timer.initialDelayNs, timer.periodNs, listener );
+			Wake(); // the new timer may be due before the current wait times out
+		}
+	}
+
+    void DetachPeriodicTimerListener( TimerListener *listener )
+	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+
+		std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+		while( i != timerListeners_.end() ){
+			if( i->listener == listener )
+				break;
+			++i;
+		}
+
+		assert( i != timerListeners_.end() );
+		if( i == timerListeners_.end() )
+			return;
+
+		if( running_ )
+			timerQueue_.Remove( i->id );
+
+		timerListeners_.erase( i );
+	}
+
+	void SetReceiveBatchSize( int batchSize )
+	{
+		assert( batchSize > 0 );
+		receiveBatchSize_ = batchSize;
+	}
+
+	int ReceiveBatchSize() const { return receiveBatchSize_; }
+
+	void SetDrainUntilEmpty( bool drainUntilEmpty, int budget )
+	{
+		assert( budget > 0 );
+		drainUntilEmpty_ = drainUntilEmpty;
+		drainBudget_ = budget;
+	}
+
+	void SetBusyPoll( bool busyPoll, int idleMicroseconds )
+	{
+		busyPoll_ = busyPoll;
+		busyPollIdleNs_ = (idleMicroseconds < 0) ? -1 : (long long)idleMicroseconds * 1000;
+	}
+
+	void GetStatistics( SocketReceiveStatistics& statistics ) const
+	{
+		statistics.wakeups = wakeups_.load( std::memory_order_relaxed );
+		statistics.batches = batches_.load( std::memory_order_relaxed );
+		statistics.datagrams = datagrams_.load( std::memory_order_relaxed );
+		statistics.maxBatchDepth = maxBatchDepth_.load( std::memory_order_relaxed );
+		statistics.drainBudgetExhausted = drainBudgetExhausted_.load( std::memory_order_relaxed );
+		statistics.kernelDrops = kernelDrops_.load( std::memory_order_relaxed );
+		statistics.truncatedDatagrams = truncatedDatagrams_.load( std::memory_order_relaxed );
+		statistics.maxReceiveQueueBytes = maxReceiveQueueBytes_.load( std::memory_order_relaxed );
+		statistics.spinPolls = spinPolls_.load( std::memory_order_relaxed );
+		statistics.spinPollsWithData = spinPollsWithData_.load( std::memory_order_relaxed );
+		statistics.blockingWaits = blockingWaits_.load( std::memory_order_relaxed );
+		for( int i=0; i < SocketReceiveStatistics::LATENCY_BUCKETS; ++i )
+			statistics.wakeToDispatch[i] = wakeToDispatch_[i].load( std::memory_order_relaxed );
+	}
+
+	// (re)schedule every attached timer relative to now, from here on
+	// attach/detach go straight to the queue
+	void StartTimers()
+	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+
+		const long long currentTimeNs = GetCurrentTimeNs();
+		timerQueue_.Clear();
+		for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+				i != timerListeners_.end(); ++i )
+			timerQueue_.Schedule( i->id, currentTimeNs + i->initialDelayNs, i->periodNs, i->listener );
+
+		running_ = true;
+	}
+
+	void StopTimers()
+	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+
+		timerQueue_.Clear();
+		running_ = false;
+	}
+
+	void RunExpiredTimers()
+	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+
+		// each expired timer fires once, a timer which fell more than a
+		// period behind skips the ticks it missed
+		const long long currentTimeNs = GetCurrentTimeNs();
+		while( !break_ ){
+			TimerListener *listener = timerQueue_.PopExpired( currentTimeNs );
+			if( !listener )
+				break;
+
+			listener->TimerExpired();
+		}
+	}
+
+	// receive and dispatch what is queued on socketListeners_[index], up to
+	// one batch or the drain budget. returns the number of datagrams.
+	int ReceiveFromSocket( std::size_t index, ReceiveSlab& slab, long long wakeTimeNs )
+	{
+		UdpSocket *socket = socketListeners_[index].second;
+		PacketListener *listener = socketListeners_[index].first;
+		const bool timestamps = socket->impl_->ReceiveTimestamps();
+		const bool dropCounting = socket->impl_->DropCounting();
+
+		// without drain-until-empty the budget is a single batch
+		const int budget = (drainUntilEmpty_) ? drainBudget_ : slab.SlotCount();
+		int total = 0;
+		IpEndpointName remoteEndpoint;
+
+		while( total < budget && !break_ ){
+			const int requested = std::min( slab.SlotCount(), budget - total );
+
+			int received = socket->impl_->ReceiveMultiple( slab.Prepare( requested, timestamps || dropCounting ), requested );
+			if( received == 0 )
+				break;
+
+			// the count is cumulative, the newest datagram carrying one has it all
+			uint32_t dropCount;
+			for( int k = received - 1; dropCounting && k >= 0; --k ){
+				if( slab.DropCount( k, dropCount ) ){
+					RecordKernelDrops( socket, dropCount );
+					break;
+				}
+			}
+
+			RecordBatch( received );
+			RecordDispatchLatency( wakeTimeNs );
+			total += received;
+
+			long long realtimeToMonotonicNs = 0, receivedNs = 0;
+			if( timestamps ){
+				realtimeToMonotonicNs = RealtimeToMonotonicOffsetNs();
+				receivedNs = MonotonicTimeNs();
+			}
+
+			for( int k = 0; k < received; ++k ){
+				std::size_t size = slab.Size( k );
+				if( size > 0 && slab.Truncated( k ) ){
+					RecordTruncated();
+				}else if( size > 0 ){
+					slab.RemoteEndpoint( k, remoteEndpoint );
+					if( timestamps ){
+						listener->ProcessTimestampedPacket( slab.Data( k ), (int)size, remoteEndpoint,
+								slab.ArrivalTimeNs( k, realtimeToMonotonicNs, receivedNs ) );
+					}else{
+						listener->ProcessPacket( slab.Data( k ), (int)size, remoteEndpoint );
+					}
+					if( break_ )
+						break;
+				}
+			}
+
+			if( received < requested )
+				break; // the socket would block
+		}
+
+		if( drainUntilEmpty_ && total >= budget )
+			RecordDrainBudgetExhausted( socket );
+
+		return total;
+	}
+
+	struct io_uring_sqe *IoUringSubmissionEntry()
+	{
+		struct io_uring_sqe *sqe = ioUring_.GetSubmissionEntry();
+		if( !sqe && ioUring_.Submit() == 0 )
+			sqe = ioUring_.GetSubmissionEntry();
+		return sqe;
+	}
+
+	// arm a multishot recvmsg which keeps delivering datagrams from
+	// socketListeners_[index] into provided buffers until it is cancelled
+	// or runs out of buffers
+	bool ArmIoUringReceive( std::size_t index, struct msghdr *header )
+	{
+		struct io_uring_sqe *sqe = IoUringSubmissionEntry();
+		if( !sqe )
+			return false;
+
+		sqe->opcode = IORING_OP_RECVMSG;
+		sqe->fd = socketListeners_[index].second->impl_->Socket();
+		sqe->addr = (unsigned long long)header;
+		sqe->len = 1;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = IO_URING_BUFFER_GROUP;
+		sqe->user_data = index;
+		return true;
+	}
+
+	// the break eventfd is watched with a one shot poll, Wake() completes it
+	bool ArmIoUringBreak()
+	{
+		struct io_uring_sqe *sqe = IoUringSubmissionEntry();
+		if( !sqe )
+			return false;
+
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->fd = breakEvent_;
+		sqe->poll32_events = POLLIN;
+		sqe->user_data = IO_URING_BREAK;
+		return true;
+	}
+
+	bool CancelIoUringReceive( std::size_t index )
+	{
+		struct io_uring_sqe *sqe = IoUringSubmissionEntry();
+		if( !sqe )
+			return false;
+
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->addr = index; // user_data of the request to cancel
+		sqe->user_data = IO_URING_CANCEL;
+		return true;
+	}
+
+	// dispatch the datagram in the provided buffer of a recvmsg completion.
+	// the buffer holds a io_uring_recvmsg_out header followed by the space
+	// reserved for the name and control data and then the payload.
+	void DispatchIoUringCompletion( const struct io_uring_cqe& cqe, std::size_t index,
+			struct msghdr *header, long long realtimeToMonotonicNs, long long receivedNs )
+	{
+		char *buffer = ioUring_.Buffer( (unsigned short)(cqe.flags >> IORING_CQE_BUFFER_SHIFT) );
+		const struct io_uring_recvmsg_out *out = (const struct io_uring_recvmsg_out*)buffer;
+		char *name = buffer + sizeof(struct io_uring_recvmsg_out);
+		char *control = name + header->msg_namelen;
+		const char *payload = control + header->msg_controllen;
+
+		std::size_t available = (std::size_t)cqe.res - (std::size_t)(payload - buffer);
+		if( (out->flags & MSG_TRUNC) || out->payloadlen > available ){
+			RecordTruncated();
+			return;
+		}
+
+		std::size_t size = out->payloadlen;
+		if( size == 0 )
+			return;
+
+		IpEndpointName remoteEndpoint;
+		if( out->namelen >= sizeof(struct sockaddr_in) ){
+			struct sockaddr_in address;
+			std::memcpy( &address, name, sizeof(address) );
+			remoteEndpoint = IpEndpointNameFromSockaddr( address );
+		}
+
+		UdpSocket *socket = socketListeners_[index].second;
+		PacketListener *listener = socketListeners_[index].first;
+
+		struct msghdr received;
+		std::memset( &received, 0, sizeof(received) );
+		if( header->msg_controllen > 0 ){
+			received.msg_control = control;
+			received.msg_controllen = out->controllen;
+		}
+
+		uint32_t dropCount;
+		if( socket->impl_->DropCounting() && ReceivedDropCount( &received, dropCount ) )
+			RecordKernelDrops( socket, dropCount );
+
+		if( socket->impl_->ReceiveTimestamps() ){
+			listener->ProcessTimestampedPacket( payload, (int)size, remoteEndpoint,
+					::ArrivalTimeNs( &received, realtimeToMonotonicNs, receivedNs ) );
+		}else{
+			listener->ProcessPacket( payload, (int)size, remoteEndpoint );
+		}
+	}
+
+	// the io_uring event loop. returns false without having dispatched
+	// anything if the kernel rejects multishot recvmsg (before 6.0), in
+	// which case the caller falls back to the epoll loop.
+	bool RunIoUring()
+	{
+		const std::size_t socketCount = socketListeners_.size();
+
+		// the kernel reads the name and control lengths of these headers
+		// for every datagram, so they must stay put while a receive is armed
+		std::vector< struct msghdr > headers( socketCount );
+		std::vector< bool > armed( socketCount, false );
+		int outstanding = 0; // armed receives plus the break poll
+		bool breakArmed = false;
+		bool failed = false;
+		bool unsupported = false;
+
+		for( std::size_t i=0; i < socketCount; ++i ){
+			std::memset( &headers[i], 0, sizeof(headers[i]) );
+			headers[i].msg_namelen = sizeof(struct sockaddr_in);
+			headers[i].msg_controllen = socketListeners_[i].second->impl_->ReceiveControl() ? RECEIVE_CONTROL_SIZE : 0;
+		}
+
+		StartTimers();
+
+		long long lastDataTimeNs = GetCurrentTimeNs();
+
+		while( !break_ ){
+
+			// (re)arm anything which isn't, multishot receives stop when
+			// they run out of buffers
+			for( std::size_t i=0; i < socketCount && !failed; ++i ){
+				if( !armed[i] ){
+					if( ArmIoUringReceive( i, &headers[i] ) ){
+						armed[i] = true;
+						++outstanding;
+					}else{
+						failed = true;
+					}
+				}
+			}
+			if( !breakArmed && !failed ){
+				if( ArmIoUringBreak() ){
+					breakArmed = true;
+					++outstanding;
+				}else{
+					failed = true;
+				}
+			}
+			if( failed )
+				break;
+
+			bool ready = false;
+			if( busyPoll_ ){
+				if( ioUring_.Submit() != 0 ){
+					failed = true;
+					break;
+				}
+
+				long long spinTimeNs = GetCurrentTimeNs();
+				spinPolls_.fetch_add( 1, std::memory_order_relaxed );
+
+				if( ioUring_.CompletionReady() ){
+					spinPollsWithData_.fetch_add( 1, std::memory_order_relaxed );
+					ready = true;
+				}else if( busyPollIdleNs_ < 0 || spinTimeNs - lastDataTimeNs < busyPollIdleNs_ ){
+					RunExpiredTimers();
+					continue;
+				}
+
+				// otherwise idle for long enough, back off to a blocking wait
+			}
+
+			if( !ready ){
+				blockingWaits_.fetch_add( 1, std::memory_order_relaxed );
+				if( ioUring_.SubmitAndWait( TimerWaitNs() ) != 0 ){
+					failed = true;
+					break;
+				}
+			}
+
+			if( break_ )
+				break;
+
+			const long long wakeTimeNs = GetCurrentTimeNs();
+			long long realtimeToMonotonicNs = 0;
+			if( ioUring_.CompletionReady() )
+				realtimeToMonotonicNs = RealtimeToMonotonicOffsetNs();
+
+			int dispatched = 0;
+			struct io_uring_cqe cqe;
+			while( !break_ && ioUring_.PopCompletion( cqe ) ){
+
+				if( cqe.user_data == IO_URING_BREAK ){
+					uint64_t value;
+					ssize_t bytes = read( breakEvent_, &value, sizeof(value) ); // reset the eventfd counter
+					(void)bytes;
+					breakArmed = false;
+					--outstanding;
+					continue;
+				}
+
+				if( cqe.user_data == IO_URING_CANCEL )
+					continue;
+
+				const std::size_t index = (std::size_t)cqe.user_data;
+				if( !(cqe.flags & IORING_CQE_F_MORE) ){
+					armed[index] = false; // rearmed at the top of the loop
+					--outstanding;
+				}
+
+				if( cqe.res < 0 ){
+					if( cqe.res == -EINVAL && datagrams_.load( std::memory_order_relaxed ) == 0 ){
+						unsupported = true;
+						break;
+					}
+					if( cqe.res != -ENOBUFS && cqe.res != -ECONNREFUSED && cqe.res != -EINTR && cqe.res != -EAGAIN ){
+						failed = true;
+						break;
+					}
+					continue;
+				}
+
+				if( cqe.flags & IORING_CQE_F_BUFFER ){
+					if( dispatched++ == 0 )
+						RecordDispatchLatency( wakeTimeNs );
+
+					DispatchIoUringCompletion( cqe, index, &headers[index], realtimeToMonotonicNs, wakeTimeNs );
+					ioUring_.RecycleBuffer( (unsigned short)(cqe.flags >> IORING_CQE_BUFFER_SHIFT) );
+				}
+			}
+			ioUring_.PublishBuffers();
+
+			if( dispatched > 0 ){
+				wakeups_.fetch_add( 1, std::memory_order_relaxed );
+				RecordBatch( dispatched );
+				lastDataTimeNs = wakeTimeNs;
+			}
+
+			if( failed || unsupported )
+				break;
+
+			// execute any expired timers
+			RunExpiredTimers();
+		}
+
+		StopTimers();
+
+		// cancel the receives and wait until the kernel is done with the
+		// headers and buffers. the break poll is completed by signalling it.
+		for( std::size_t i=0; i < socketCount; ++i ){
+			if( armed[i] && !CancelIoUringReceive( i ) )
+				failed = true;
+		}
+		if( breakArmed )
+			Wake();
+
+		while( outstanding > 0 ){
+			if( ioUring_.SubmitAndWait( -1 ) != 0 ){
+				failed = true;
+				break;
+			}
+
+			struct io_uring_cqe cqe;
+			while( ioUring_.PopCompletion( cqe ) ){
+				if( cqe.user_data == IO_URING_BREAK ){
+					uint64_t value;
+					ssize_t bytes = read( breakEvent_, &value, sizeof(value) );
+					(void)bytes;
+					--outstanding;
+				}else if( cqe.user_data != IO_URING_CANCEL ){
+					if( cqe.flags & IORING_CQE_F_BUFFER )
+						ioUring_.RecycleBuffer( (unsigned short)(cqe.flags >> IORING_CQE_BUFFER_SHIFT) );
+					if( !(cqe.flags & IORING_CQE_F_MORE) )
+						--outstanding;
+				}
+			}
+			ioUring_.PublishBuffers();
+		}
+
+		// the epoll loop takes over the break when io_uring is unsupported
+		if( !unsupported )
+			break_ = false;
+
+		if( failed )
+			throw std::runtime_error("io_uring receive failed\n");
+
+		return !unsupported;
+	}
+
+    void Run()
+	{
+		if( backend_ == IO_URING_RECEIVE_BACKEND ){
+			if( RunIoUring() )
+				return;
+
+			backend_ = WAIT_RECEIVE_BACKEND; // multishot recvmsg was rejected
+		}
+
+		RunWait();
+	}
+
+	// what RunWait() sets up for one run: the sockets, made non-blocking,
+	// and the break eventfd in the epoll set, and the timers. it is undone
+	// when the run ends however it ends, so a failed registration or a
+	// throwing listener leaves the multiplexer ready for the next Run().
+	class WaitRegistration{
+	public:
+		WaitRegistration( Implementation& multiplexer )
+			: multiplexer_( multiplexer )
+			, socketCount_( 0 )
+			, breakEventAdded_( false )
+			, timersStarted_( false ) {}
+
+		~WaitRegistration()
+		{
+			if( timersStarted_ )
+				multiplexer_.StopTimers();
+
+			if( breakEventAdded_ )
+				epoll_ctl( multiplexer_.epoll_, EPOLL_CTL_DEL, multiplexer_.breakEvent_, 0 );
+
+			for( std::size_t i=0; i < socketCount_; ++i ){
+				int fd = multiplexer_.socketListeners_[i].second->impl_->Socket();
+				epoll_ctl( multiplexer_.epoll_, EPOLL_CTL_DEL, fd, 0 );
+				SetNonBlocking( fd, false );
+			}
+		}
+
+		// the event data holds the index into socketListeners_, the break
+		// eventfd is registered with the index one past the last socket so
+		// it can be told apart in the event loop.
+		void Register()
+		{
+			const std::size_t count = multiplexer_.socketListeners_.size();
+			for( ; socketCount_ < count; ++socketCount_ ){
+				int fd = multiplexer_.socketListeners_[socketCount_].second->impl_->Socket();
+				SetNonBlocking( fd, true ); // epoll is level triggered but non-blocking sockets make a spurious wakeup harmless
+
+				if( !Add( fd, (uint32_t)socketCount_ ) ){
+					SetNonBlocking( fd, false );
+					throw std::runtime_error("unable to register socket with epoll\n");
+				}
+			}
+
+			if( !Add( multiplexer_.breakEvent_, (uint32_t)count ) )
+				throw std::runtime_error("unable to register break eventfd with epoll\n");
+			breakEventAdded_ = true;
+
+			multiplexer_.StartTimers();
+			timersStarted_ = true;
+		}
+
+	private:
+		bool Add( int fd, uint32_t index )
+		{
+			struct epoll_event event;
+			std::memset( &event, 0, sizeof(event) );
+			event.events = EPOLLIN;
+			event.data.u32 = index;
+			return epoll_ctl( multiplexer_.epoll_, EPOLL_CTL_ADD, fd, &event ) == 0;
+		}
+
+		Implementation& multiplexer_;
+		std::size_t socketCount_; // sockets added, from the first
+		bool breakEventAdded_;
+		bool timersStarted_;
+	};
+
+    void RunWait()
+	{
+		const uint32_t breakEventIndex = (uint32_t)socketListeners_.size();
+
+		std::vector< struct epoll_event > events( socketListeners_.size() + 1 );
+
+		WaitRegistration registration( *this );
+		registration.Register();
+
+		const int MAX_BUFFER_SIZE = 4098;
+		ReceiveSlab slab( receiveBatchSize_, MAX_BUFFER_SIZE );
+		bool failed = false;
+
+		// in busy-poll mode, when the sockets were last found to have data
+		long long lastDataTimeNs = GetCurrentTimeNs();
+
+		while( !break_ ){
+
+			if( busyPoll_ ){
+				long long wakeTimeNs = GetCurrentTimeNs();
+				spinPolls_.fetch_add( 1, std::memory_order_relaxed );
+
+				int received = 0;
+				for( std::size_t i = 0; i < socketListeners_.size() && !break_; ++i )
+					received += ReceiveFromSocket( i, slab, wakeTimeNs );
+
+				if( received > 0 ){
+					spinPollsWithData_.fetch_add( 1, std::memory_order_relaxed );
+					lastDataTimeNs = wakeTimeNs;
+				}
+
+				if( received > 0 || busyPollIdleNs_ < 0 || wakeTimeNs - lastDataTimeNs < busyPollIdleNs_ ){
+					RunExpiredTimers();
+					continue;
+				}
+
+				// idle for long enough, back off to a blocking wait
+			}
+
+			int waitTime = TimerWaitMs();
+
+			blockingWaits_.fetch_add( 1, std::memory_order_relaxed );
+			int eventCount = epoll_wait( epoll_, &events[0], (int)events.size(), waitTime );
+			if( eventCount < 0 ){
+				if( errno == EINTR ){
+					if( !break_ ) continue;
+					else break;
+				}
+				failed = true;
+				break;
+			}
+
+			if( break_ )
+				break;
+
+			long long wakeTimeNs = GetCurrentTimeNs();
+			if( eventCount > 0 )
+				wakeups_.fetch_add( 1, std::memory_order_relaxed );
+
+			for( int i = 0; i < eventCount && !break_; ++i ){
+				const uint32_t index = events[i].data.u32;
+
+				if( index == breakEventIndex ){
+					uint64_t value;
+					ssize_t bytes = read( breakEvent_, &value, sizeof(value) ); // reset the eventfd counter
+					(void)bytes;
+					continue;
+				}
+
+				if( ReceiveFromSocket( index, slab, wakeTimeNs ) > 0 )
+					lastDataTimeNs = wakeTimeNs;
+			}
+
+			// execute any expired timers
+			RunExpiredTimers();
+		}
+
+		break_ = false;
+
+		if( failed )
+			throw std::runtime_error("epoll_wait failed\n");
+	}
+
+    void Break()
+	{
+		break_ = true;
+	}
+
+    void AsynchronousBreak()
+	{
+		break_ = true;
+
+		// Send a signal to the eventfd to wake up epoll_wait
+		Wake();
+	}
+};
+
+
+
+SocketReceiveMultiplexer::SocketReceiveMultiplexer( SocketReceiveBackend backend )
+{
+	impl_ = new Implementation( backend );
+}
+
+SocketReceiveMultiplexer::~SocketReceiveMultiplexer()
+{	
+	delete impl_;
+}
+
+SocketReceiveBackend SocketReceiveMultiplexer::Backend() const
+{
+	return impl_->Backend();
+}
+
+void SocketReceiveMultiplexer::AttachSocketListener( UdpSocket *socket, PacketListener *listener )
+{
+	impl_->AttachSocketListener( socket, listener );
+}
+
+void SocketReceiveMultiplexer::DetachSocketListener( UdpSocket *socket, PacketListener *listener )
+{
+	impl_->DetachSocketListener( socket, listener );
+}
+
+void SocketReceiveMultiplexer::AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
+{
+	impl_->AttachPeriodicTimerListener( periodMilliseconds, listener );
+}
+
+void SocketReceiveMultiplexer::AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
+{
+	impl_->AttachPeriodicTimerListener( initialDelayMilliseconds, periodMilliseconds, listener );
+}
+
+void SocketReceiveMultiplexer::DetachPeriodicTimerListener( TimerListener *listener )
+{
+	impl_->DetachPeriodicTimerListener( listener );
+}
+
+void SocketReceiveMultiplexer::SetReceiveBatchSize( int batchSize )
+{
+	impl_->SetReceiveBatchSize( batchSize );
+}
+
+int SocketReceiveMultiplexer::ReceiveBatchSize() const
+{
+	return impl_->ReceiveBatchSize();
+}
+
+void SocketReceiveMultiplexer::SetDrainUntilEmpty( bool drainUntilEmpty, int budget )
+{
+	impl_->SetDrainUntilEmpty( drainUntilEmpty, budget );
+}
+
+void SocketReceiveMultiplexer::SetBusyPoll( bool busyPoll, int idleMicroseconds )
+{
+	impl_->SetBusyPoll( busyPoll, idleMicroseconds );
+}
+
+void SocketReceiveMultiplexer::GetStatistics( SocketReceiveStatistics& statistics ) const
+{
+	impl_->GetStatistics( statistics );
+}
+
+void SocketReceiveMultiplexer::Run()
+{
+	impl_->Run();
+}
+
+void SocketReceiveMultiplexer::RunUntilSigInt()
+{
+	assert( multiplexerInstanceToAbortWithSigInt_ == 0 ); /* at present we support only one multiplexer instance running until sig int */
+	multiplexerInstanceToAbortWithSigInt_ = this;
+	signal( SIGINT, InterruptSignalHandler );
+	impl_->Run();
+	signal( SIGINT, SIG_DFL );
+	multiplexerInstanceToAbortWithSigInt_ = 0;
+}
+
+void SocketReceiveMultiplexer::Break()
+{
+	impl_->Break();
+}
+
+void SocketReceiveMultiplexer::AsynchronousBreak()
+{
+	impl_->AsynchronousBreak();
+}
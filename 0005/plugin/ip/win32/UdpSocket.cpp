@@ -37,15 +37,18 @@
 
 #include <winsock2.h>   // this must come first to prevent errors with MSVC7
 #include <windows.h>
-#include <mmsystem.h>   // for timeGetTime()
+#include <ws2tcpip.h>   // for ip_mreq
 
 #ifndef WINCE
 #include <signal.h>
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstring> // for memset
+#include <mutex>
 #include <stdexcept>
 #include <vector>
 
@@ -56,6 +59,7 @@
 #include "ip/NetworkingUtils.h"
 #include "ip/PacketListener.h"
 #include "ip/TimerListener.h"
+#include "ip/TimerQueue.h"
 
 
 typedef int socklen_t;
@@ -91,11 +95,31 @@ static IpEndpointName IpEndpointNameFromSockaddr( const struct sockaddr_in& sock
 }
 
 
+static struct in_addr InAddrFromAddress( unsigned long address )
+{
+	struct in_addr result;
+	result.s_addr = 
+		(address == IpEndpointName::ANY_ADDRESS)
+		? INADDR_ANY
+		: htonl( address );
+	return result;
+}
+
+
+static void MulticastRequestFor( struct ip_mreq& request, const IpEndpointName& group, unsigned long interfaceAddress )
+{
+	std::memset( &request, 0, sizeof(request) );
+	request.imr_multiaddr.s_addr = htonl( group.address );
+	request.imr_interface = InAddrFromAddress( interfaceAddress );
+}
+
+
 class UdpSocket::Implementation{
     NetworkInitializer networkInitializer_;
 
 	bool isBound_;
 	bool isConnected_;
+	bool receiveTimestamps_;
 
 	SOCKET socket_;
 	struct sockaddr_in connectedAddr_;
@@ -106,6 +130,7 @@ public:
 	Implementation()
 		: isBound_( false )
 		, isConnected_( false )
+		, receiveTimestamps_( false )
 		, socket_( INVALID_SOCKET )
 	{
 		if( (socket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == INVALID_SOCKET ){
@@ -137,6 +162,86 @@ public:
 		setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
 	}
 
+	bool SetAllowReusePort( bool allowReusePort )
+	{
+		// winsock has no SO_REUSEPORT. SO_REUSEADDR lets several sockets bind
+		// the same port but datagrams are not distributed between them.
+		(void)allowReusePort;
+		return false;
+	}
+
+	void SetEnableReceiveTimestamps( bool enableReceiveTimestamps )
+	{
+		// there is no kernel receive timestamp we can rely on here, the
+		// multiplexer stamps each datagram as soon as recvfrom() returns it.
+		receiveTimestamps_ = enableReceiveTimestamps;
+	}
+
+	bool ReceiveTimestamps() const { return receiveTimestamps_; }
+
+	int SetBufferSize( int option, int size )
+	{
+		setsockopt(socket_, SOL_SOCKET, option, (const char*)&size, sizeof(size));
+		return BufferSize( option );
+	}
+
+	int BufferSize( int option ) const
+	{
+		int size = 0;
+		int length = sizeof(size);
+		if( getsockopt(socket_, SOL_SOCKET, option, (char*)&size, &length) == SOCKET_ERROR )
+			return 0;
+		return size;
+	}
+
+	int SetReceiveBufferSize( int size ) { return SetBufferSize( SO_RCVBUF, size ); }
+	int SetSendBufferSize( int size ) { return SetBufferSize( SO_SNDBUF, size ); }
+	int ReceiveBufferSize() const { return BufferSize( SO_RCVBUF ); }
+	int SendBufferSize() const { return BufferSize( SO_SNDBUF ); }
+
+	bool SetEnableDropCounting( bool enableDropCounting )
+	{
+		// winsock doesn't report datagrams dropped for lack of buffer space
+		(void)enableDropCounting;
+		return false;
+	}
+
+	void JoinMulticastGroup( const IpEndpointName& group, unsigned long interfaceAddress )
+	{
+		struct ip_mreq request;
+		MulticastRequestFor( request, group, interfaceAddress );
+
+		if( setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&request, sizeof(request)) == SOCKET_ERROR ){
+			throw std::runtime_error("unable to join multicast group\n");
+		}
+	}
+
+	void LeaveMulticastGroup( const IpEndpointName& group, unsigned long interfaceAddress )
+	{
+		struct ip_mreq request;
+		MulticastRequestFor( request, group, interfaceAddress );
+
+		setsockopt(socket_, IPPROTO_IP, IP_DROP_MEMBERSHIP, (const char*)&request, sizeof(request));
+	}
+
+	void SetMulticastInterface( unsigned long interfaceAddress )
+	{
+		struct in_addr address = InAddrFromAddress( interfaceAddress );
+		setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, (const char*)&address, sizeof(address));
+	}
+
+	void SetMulticastTimeToLive( int timeToLive )
+	{
+		DWORD ttl = (DWORD)((timeToLive < 0) ? 0 : (timeToLive > 255) ? 255 : timeToLive); // DWORD on win32
+		setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&ttl, sizeof(ttl));
+	}
+
+	void SetEnableMulticastLoopback( bool enableLoopback )
+	{
+		DWORD loop = (DWORD)((enableLoopback) ? 1 : 0); // DWORD on win32
+		setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&loop, sizeof(loop));
+	}
+
 	IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
 	{
 		assert( isBound_ );
@@ -207,6 +312,20 @@ public:
         sendto( socket_, data, (int)size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
 	}
 
+	std::size_t SendMultiple( const OutgoingDatagram *datagrams, std::size_t count )
+	{
+		// winsock has no sendmmsg(), the loop at least skips the per call
+		// overhead of the public interface
+		std::size_t sent = 0;
+		for( std::size_t i=0; i < count; ++i ){
+			struct sockaddr_in address;
+			SockaddrFromIpEndpointName( address, datagrams[i].remoteEndpoint );
+			if( sendto( socket_, datagrams[i].data, (int)datagrams[i].size, 0, (sockaddr*)&address, sizeof(address) ) != SOCKET_ERROR )
+				++sent;
+		}
+		return sent;
+	}
+
 	void Bind( const IpEndpointName& localEndpoint )
 	{
 		struct sockaddr_in bindSockAddr;
@@ -239,6 +358,15 @@ public:
 		return result;
 	}
 
+	std::size_t ReceiveQueueBytes() const
+	{
+		u_long pending = 0;
+		if( ioctlsocket( socket_, FIONREAD, &pending ) == SOCKET_ERROR )
+			return 0;
+
+		return (std::size_t)pending;
+	}
+
 	SOCKET& Socket() { return socket_; }
 };
 
@@ -262,6 +390,66 @@ void UdpSocket::SetAllowReuse( bool allowReuse )
     impl_->SetAllowReuse( allowReuse );
 }
 
+bool UdpSocket::SetAllowReusePort( bool allowReusePort )
+{
+    return impl_->SetAllowReusePort( allowReusePort );
+}
+
+void UdpSocket::SetEnableReceiveTimestamps( bool enableReceiveTimestamps )
+{
+    impl_->SetEnableReceiveTimestamps( enableReceiveTimestamps );
+}
+
+int UdpSocket::SetReceiveBufferSize( int size )
+{
+	return impl_->SetReceiveBufferSize( size );
+}
+
+int UdpSocket::SetSendBufferSize( int size )
+{
+	return impl_->SetSendBufferSize( size );
+}
+
+int UdpSocket::ReceiveBufferSize() const
+{
+	return impl_->ReceiveBufferSize();
+}
+
+int UdpSocket::SendBufferSize() const
+{
+	return impl_->SendBufferSize();
+}
+
+bool UdpSocket::SetEnableDropCounting( bool enableDropCounting )
+{
+	return impl_->SetEnableDropCounting( enableDropCounting );
+}
+
+void UdpSocket::JoinMulticastGroup( const IpEndpointName& group, unsigned long interfaceAddress )
+{
+	impl_->JoinMulticastGroup( group, interfaceAddress );
+}
+
+void UdpSocket::LeaveMulticastGroup( const IpEndpointName& group, unsigned long interfaceAddress )
+{
+	impl_->LeaveMulticastGroup( group, interfaceAddress );
+}
+
+void UdpSocket::SetMulticastInterface( unsigned long interfaceAddress )
+{
+	impl_->SetMulticastInterface( interfaceAddress );
+}
+
+void UdpSocket::SetMulticastTimeToLive( int timeToLive )
+{
+	impl_->SetMulticastTimeToLive( timeToLive );
+}
+
+void UdpSocket::SetEnableMulticastLoopback( bool enableLoopback )
+{
+	impl_->SetEnableMulticastLoopback( enableLoopback );
+}
+
 IpEndpointName UdpSocket::LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
 {
 	return impl_->LocalEndpointFor( remoteEndpoint );
@@ -282,6 +470,11 @@ void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data,
 	impl_->SendTo( remoteEndpoint, data, size );
 }
 
+std::size_t UdpSocket::SendMultiple( const OutgoingDatagram *datagrams, std::size_t count )
+{
+	return impl_->SendMultiple( datagrams, count );
+}
+
 void UdpSocket::Bind( const IpEndpointName& localEndpoint )
 {
 	impl_->Bind( localEndpoint );
@@ -297,25 +490,52 @@ std::size_t UdpSocket::ReceiveFrom( IpEndpointName& remoteEndpoint, char *data,
 	return impl_->ReceiveFrom( remoteEndpoint, data, size );
 }
 
+std::size_t UdpSocket::ReceiveQueueBytes() const
+{
+	return impl_->ReceiveQueueBytes();
+}
+
+
+// winsock has no recvmmsg() so a batch is gathered with repeated non-blocking
+// recvfrom() calls into a preallocated slab, one slot per datagram, and then
+// dispatched back-to-back.
+class ReceiveSlab{
+	int slotCount_;
+	int slotSize_;
+	std::vector< char > data_;
+
+public:
+	std::vector< std::size_t > sizes;
+	std::vector< IpEndpointName > remoteEndpoints;
+	std::vector< long long > arrivalTimes;
+
+	ReceiveSlab( int slotCount, int slotSize )
+		: slotCount_( slotCount )
+		, slotSize_( slotSize )
+		, data_( (std::size_t)slotCount * slotSize )
+		, sizes( slotCount )
+		, remoteEndpoints( slotCount )
+		, arrivalTimes( slotCount ) {}
+
+	int SlotCount() const { return slotCount_; }
+	int SlotSize() const { return slotSize_; }
+	char *Data( int i ) { return &data_[ (std::size_t)i * slotSize_ ]; }
+};
+
 
 struct AttachedTimerListener{
-	AttachedTimerListener( int id, int p, TimerListener *tl )
-		: initialDelayMs( id )
-		, periodMs( p )
+	AttachedTimerListener( unsigned long long i, long long d, long long p, TimerListener *tl )
+		: id( i )
+		, initialDelayNs( d )
+		, periodNs( p )
 		, listener( tl ) {}
-	int initialDelayMs;
-	int periodMs;
+	unsigned long long id;
+	long long initialDelayNs;
+	long long periodNs;
 	TimerListener *listener;
 };
 
 
-static bool CompareScheduledTimerCalls( 
-		const std::pair< double, AttachedTimerListener > & lhs, const std::pair< double, AttachedTimerListener > & rhs )
-{
-	return lhs.first < rhs.first;
-}
-
-
 SocketReceiveMultiplexer *multiplexerInstanceToAbortWithSigInt_ = 0;
 
 extern "C" /*static*/ void InterruptSignalHandler( int );
@@ -334,21 +554,114 @@ class SocketReceiveMultiplexer::Implementation{
 	std::vector< std::pair< PacketListener*, UdpSocket* > > socketListeners_;
 	std::vector< AttachedTimerListener > timerListeners_;
 
-	volatile bool break_;
+	// timerMutex_ guards the timer state so that timers can be attached and
+	// detached while Run() is active. Run() holds it while calling
+	// TimerExpired(): it is recursive so that a listener can detach itself,
+	// and a detach from another thread returns only once the call is over.
+	mutable std::recursive_mutex timerMutex_;
+	TimerQueue timerQueue_;
+	unsigned long long nextTimerId_;
+	bool running_;
+
+	// set by AsynchronousBreak() from other threads. it is cleared when a
+	// run ends, so a break that comes before Run() still ends that run.
+	std::atomic< bool > break_;
+	bool drainUntilEmpty_;
+	int drainBudget_;
 	HANDLE breakEvent_;
+	int receiveBatchSize_;
+	bool busyPoll_;
+	long long busyPollIdleNs_;
+
+	std::atomic< unsigned long long > wakeups_;
+	std::atomic< unsigned long long > batches_;
+	std::atomic< unsigned long long > datagrams_;
+	std::atomic< unsigned int > maxBatchDepth_;
+	std::atomic< unsigned long long > drainBudgetExhausted_;
+	std::atomic< unsigned long long > kernelDrops_; // never counted on win32
+	std::atomic< unsigned long long > truncatedDatagrams_; // never counted on win32
+	std::atomic< unsigned long long > maxReceiveQueueBytes_;
+	std::atomic< unsigned long long > spinPolls_;
+	std::atomic< unsigned long long > spinPollsWithData_;
+	std::atomic< unsigned long long > blockingWaits_;
+	std::atomic< unsigned long long > wakeToDispatch_[ SocketReceiveStatistics::LATENCY_BUCKETS ];
+
+	long long GetCurrentTimeNs() const
+	{
+		return std::chrono::duration_cast< std::chrono::nanoseconds >(
+				std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
 
-	double GetCurrentTimeMs() const
+	// wake WaitForMultipleObjects() so the loop rechecks break_ and the timer queue
+	void Wake()
 	{
-#ifndef WINCE
-		return timeGetTime(); // FIXME: bad choice if you want to run for more than 40 days
-#else
-        return 0;
-#endif
-    }
+		SetEvent( breakEvent_ );
+	}
+
+	// milliseconds until the next timer is due, rounded up so that we don't
+	// wake before it. INFINITE when there are no timers.
+	DWORD TimerWaitMs() const
+	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+		if( timerQueue_.Empty() )
+			return INFINITE;
+
+		long long remainingNs = timerQueue_.NextDeadlineNs() - GetCurrentTimeNs();
+		if( remainingNs <= 0 )
+			return 0;
+
+		long long ms = (remainingNs + 999999) / 1000000;
+		return (ms < (long long)INFINITE) ? (DWORD)ms : INFINITE - 1;
+	}
+
+	void RecordBatch( int received )
+	{
+		batches_.fetch_add( 1, std::memory_order_relaxed );
+		datagrams_.fetch_add( (unsigned long long)received, std::memory_order_relaxed );
+		if( (unsigned int)received > maxBatchDepth_.load( std::memory_order_relaxed ) )
+			maxBatchDepth_.store( (unsigned int)received, std::memory_order_relaxed );
+	}
+
+	void RecordDispatchLatency( long long wakeTimeNs )
+	{
+		int bucket = SocketReceiveStatistics::LatencyBucket( GetCurrentTimeNs() - wakeTimeNs );
+		wakeToDispatch_[bucket].fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	void RecordDrainBudgetExhausted( UdpSocket *socket )
+	{
+		drainBudgetExhausted_.fetch_add( 1, std::memory_order_relaxed );
+
+		unsigned long long queued = socket->ReceiveQueueBytes();
+		if( queued > maxReceiveQueueBytes_.load( std::memory_order_relaxed ) )
+			maxReceiveQueueBytes_.store( queued, std::memory_order_relaxed );
+	}
 
 public:
     Implementation()
+		: nextTimerId_( 0 )
+		, running_( false )
+		, break_( false )
+		, drainUntilEmpty_( false )
+		, drainBudget_( 256 )
+		, receiveBatchSize_( 1 )
+		, busyPoll_( false )
+		, busyPollIdleNs_( -1 )
+		, wakeups_( 0 )
+		, batches_( 0 )
+		, datagrams_( 0 )
+		, maxBatchDepth_( 0 )
+		, drainBudgetExhausted_( 0 )
+		, kernelDrops_( 0 )
+		, truncatedDatagrams_( 0 )
+		, maxReceiveQueueBytes_( 0 )
+		, spinPolls_( 0 )
+		, spinPollsWithData_( 0 )
+		, blockingWaits_( 0 )
 	{
+		for( int i=0; i < SocketReceiveStatistics::LATENCY_BUCKETS; ++i )
+			wakeToDispatch_[i].store( 0, std::memory_order_relaxed );
+
 		breakEvent_ = CreateEvent( NULL, FALSE, FALSE, NULL );
 	}
 
@@ -375,16 +688,27 @@ public:
 
     void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
 	{
-		timerListeners_.push_back( AttachedTimerListener( periodMilliseconds, periodMilliseconds, listener ) );
+		AttachPeriodicTimerListener( periodMilliseconds, periodMilliseconds, listener );
 	}
 
 	void AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
 	{
-		timerListeners_.push_back( AttachedTimerListener( initialDelayMilliseconds, periodMilliseconds, listener ) );
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+
+		AttachedTimerListener timer( nextTimerId_++,
+				(long long)initialDelayMilliseconds * 1000000, (long long)periodMilliseconds * 1000000, listener );
+		timerListeners_.push_back( timer );
+
+		if( running_ ){
+			timerQueue_.Schedule( timer.id, GetCurrentTimeNs() + timer.initialDelayNs, timer.periodNs, listener );
+			Wake(); // the new timer may be due before the current wait times out
+		}
 	}
 
     void DetachPeriodicTimerListener( TimerListener *listener )
 	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+
 		std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
 		while( i != timerListeners_.end() ){
 			if( i->listener == listener )
@@ -393,14 +717,147 @@ public:
 		}
 
 		assert( i != timerListeners_.end() );
+		if( i == timerListeners_.end() )
+			return;
+
+		if( running_ )
+			timerQueue_.Remove( i->id );
 
 		timerListeners_.erase( i );
 	}
 
-    void Run()
+	void SetReceiveBatchSize( int batchSize )
 	{
-		break_ = false;
+		assert( batchSize > 0 );
+		receiveBatchSize_ = batchSize;
+	}
+
+	int ReceiveBatchSize() const { return receiveBatchSize_; }
+
+	void SetDrainUntilEmpty( bool drainUntilEmpty, int budget )
+	{
+		assert( budget > 0 );
+		drainUntilEmpty_ = drainUntilEmpty;
+		drainBudget_ = budget;
+	}
+
+	void SetBusyPoll( bool busyPoll, int idleMicroseconds )
+	{
+		busyPoll_ = busyPoll;
+		busyPollIdleNs_ = (idleMicroseconds < 0) ? -1 : (long long)idleMicroseconds * 1000;
+	}
+
+	void GetStatistics( SocketReceiveStatistics& statistics ) const
+	{
+		statistics.wakeups = wakeups_.load( std::memory_order_relaxed );
+		statistics.batches = batches_.load( std::memory_order_relaxed );
+		statistics.datagrams = datagrams_.load( std::memory_order_relaxed );
+		statistics.maxBatchDepth = maxBatchDepth_.load( std::memory_order_relaxed );
+		statistics.drainBudgetExhausted = drainBudgetExhausted_.load( std::memory_order_relaxed );
+		statistics.kernelDrops = kernelDrops_.load( std::memory_order_relaxed );
+		statistics.truncatedDatagrams = truncatedDatagrams_.load( std::memory_order_relaxed );
+		statistics.maxReceiveQueueBytes = maxReceiveQueueBytes_.load( std::memory_order_relaxed );
+		statistics.spinPolls = spinPolls_.load( std::memory_order_relaxed );
+		statistics.spinPollsWithData = spinPollsWithData_.load( std::memory_order_relaxed );
+		statistics.blockingWaits = blockingWaits_.load( std::memory_order_relaxed );
+		for( int i=0; i < SocketReceiveStatistics::LATENCY_BUCKETS; ++i )
+			statistics.wakeToDispatch[i] = wakeToDispatch_[i].load( std::memory_order_relaxed );
+	}
+
+	// (re)schedule every attached timer relative to now, from here on
+	// attach/detach go straight to the queue
+	void StartTimers()
+	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+
+		const long long currentTimeNs = GetCurrentTimeNs();
+		timerQueue_.Clear();
+		for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+				i != timerListeners_.end(); ++i )
+			timerQueue_.Schedule( i->id, currentTimeNs + i->initialDelayNs, i->periodNs, i->listener );
+
+		running_ = true;
+	}
+
+	void StopTimers()
+	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+
+		timerQueue_.Clear();
+		running_ = false;
+	}
+
+	void RunExpiredTimers()
+	{
+		std::lock_guard< std::recursive_mutex > lock( timerMutex_ );
+
+		// each expired timer fires once, a timer which fell more than a
+		// period behind skips the ticks it missed
+		const long long currentTimeNs = GetCurrentTimeNs();
+		while( !break_ ){
+			TimerListener *listener = timerQueue_.PopExpired( currentTimeNs );
+			if( !listener )
+				break;
+
+			listener->TimerExpired();
+		}
+	}
+
+	// receive and dispatch what is queued on socketListeners_[index], up to
+	// one batch or the drain budget. returns the number of datagrams.
+	int ReceiveFromSocket( std::size_t index, ReceiveSlab& slab, long long wakeTimeNs )
+	{
+		UdpSocket *socket = socketListeners_[index].second;
+		PacketListener *listener = socketListeners_[index].first;
+		const bool timestamps = socket->impl_->ReceiveTimestamps();
+
+		// without drain-until-empty the budget is a single batch
+		const int budget = (drainUntilEmpty_) ? drainBudget_ : slab.SlotCount();
+		int total = 0;
 
+		while( total < budget && !break_ ){
+			const int requested = (budget - total < slab.SlotCount()) ? budget - total : slab.SlotCount();
+
+			int received = 0;
+			while( received < requested ){
+				std::size_t size = socket->ReceiveFrom( slab.remoteEndpoints[received], slab.Data( received ), slab.SlotSize() );
+				if( size == 0 )
+					break;
+				if( timestamps )
+					slab.arrivalTimes[received] = GetCurrentTimeNs();
+				slab.sizes[received++] = size;
+			}
+
+			if( received == 0 )
+				break;
+
+			RecordBatch( received );
+			RecordDispatchLatency( wakeTimeNs );
+			total += received;
+
+			for( int k = 0; k < received; ++k ){
+				if( timestamps ){
+					listener->ProcessTimestampedPacket(
+							slab.Data( k ), (int)slab.sizes[k], slab.remoteEndpoints[k], slab.arrivalTimes[k] );
+				}else{
+					listener->ProcessPacket( slab.Data( k ), (int)slab.sizes[k], slab.remoteEndpoints[k] );
+				}
+				if( break_ )
+					break;
+			}
+
+			if( received < requested )
+				break; // the socket would block
+		}
+
+		if( drainUntilEmpty_ && total >= budget )
+			RecordDrainBudgetExhausted( socket );
+
+		return total;
+	}
+
+    void Run()
+	{
 		// prepare the window events which we use to wake up on incoming data
 		// we use this instead of select() primarily to support the AsyncBreak() 
 		// mechanism.
@@ -419,65 +876,60 @@ public:
 		events[ socketListeners_.size() ] = breakEvent_; // last event in the collection is the break event
 
 		
-		// configure the timer queue
-		double currentTimeMs = GetCurrentTimeMs();
-
-		// expiry time ms, listener
-		std::vector< std::pair< double, AttachedTimerListener > > timerQueue_;
-		for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
-				i != timerListeners_.end(); ++i )
-			timerQueue_.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
-		std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+		StartTimers();
 
 		const int MAX_BUFFER_SIZE = 4098;
-		char *data = new char[ MAX_BUFFER_SIZE ];
-		IpEndpointName remoteEndpoint;
+		ReceiveSlab slab( receiveBatchSize_, MAX_BUFFER_SIZE );
+
+		// in busy-poll mode, when the sockets were last found to have data
+		long long lastDataTimeNs = GetCurrentTimeNs();
 
 		while( !break_ ){
 
-			currentTimeMs = GetCurrentTimeMs();
+			if( busyPoll_ ){
+				long long wakeTimeNs = GetCurrentTimeNs();
+				spinPolls_.fetch_add( 1, std::memory_order_relaxed );
+
+				int received = 0;
+				for( std::size_t i = 0; i < socketListeners_.size() && !break_; ++i )
+					received += ReceiveFromSocket( i, slab, wakeTimeNs );
+
+				if( received > 0 ){
+					spinPollsWithData_.fetch_add( 1, std::memory_order_relaxed );
+					lastDataTimeNs = wakeTimeNs;
+				}
+
+				if( received > 0 || busyPollIdleNs_ < 0 || wakeTimeNs - lastDataTimeNs < busyPollIdleNs_ ){
+					RunExpiredTimers();
+					continue;
+				}
 
-            DWORD waitTime = INFINITE;
-            if( !timerQueue_.empty() ){
+				// idle for long enough, back off to a blocking wait
+			}
 
-                waitTime = (DWORD)( timerQueue_.front().first >= currentTimeMs
-                            ? timerQueue_.front().first - currentTimeMs
-                            : 0 );
-            }
+            DWORD waitTime = TimerWaitMs();
 
+			blockingWaits_.fetch_add( 1, std::memory_order_relaxed );
 			DWORD waitResult = WaitForMultipleObjects( (DWORD)socketListeners_.size() + 1, &events[0], FALSE, waitTime );
 			if( break_ )
 				break;
 
 			if( waitResult != WAIT_TIMEOUT ){
-				for( int i = waitResult - WAIT_OBJECT_0; i < (int)socketListeners_.size(); ++i ){
-					std::size_t size = socketListeners_[i].second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
-					if( size > 0 ){
-						socketListeners_[i].first->ProcessPacket( data, (int)size, remoteEndpoint );
-						if( break_ )
-							break;
-					}
+				long long wakeTimeNs = GetCurrentTimeNs();
+				if( (int)(waitResult - WAIT_OBJECT_0) < (int)socketListeners_.size() )
+					wakeups_.fetch_add( 1, std::memory_order_relaxed );
+
+				for( int i = waitResult - WAIT_OBJECT_0; i < (int)socketListeners_.size() && !break_; ++i ){
+					if( ReceiveFromSocket( i, slab, wakeTimeNs ) > 0 )
+						lastDataTimeNs = wakeTimeNs;
 				}
 			}
 
 			// execute any expired timers
-			currentTimeMs = GetCurrentTimeMs();
-			bool resort = false;
-			for( std::vector< std::pair< double, AttachedTimerListener > >::iterator i = timerQueue_.begin();
-					i != timerQueue_.end() && i->first <= currentTimeMs; ++i ){
-
-				i->second.listener->TimerExpired();
-				if( break_ )
-					break;
-
-				i->first += i->second.periodMs;
-				resort = true;
-			}
-			if( resort )
-				std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+			RunExpiredTimers();
 		}
 
-		delete [] data;
+		StopTimers();
 
 		// free events
 		j = 0;
@@ -489,6 +941,8 @@ public:
 			unsigned long enableNonblocking = 0;
 			ioctlsocket( i->second->impl_->Socket(), FIONBIO, &enableNonblocking );  // make the socket blocking again
 		}
+
+		break_ = false;
 	}
 
     void Break()
@@ -499,17 +953,23 @@ public:
     void AsynchronousBreak()
 	{
 		break_ = true;
-		SetEvent( breakEvent_ );
+		Wake();
 	}
 };
 
 
 
-SocketReceiveMultiplexer::SocketReceiveMultiplexer()
+SocketReceiveMultiplexer::SocketReceiveMultiplexer( SocketReceiveBackend backend )
 {
+	(void) backend; // io_uring is linux only, there is only the wait backend here
 	impl_ = new Implementation();
 }
 
+SocketReceiveBackend SocketReceiveMultiplexer::Backend() const
+{
+	return WAIT_RECEIVE_BACKEND;
+}
+
 SocketReceiveMultiplexer::~SocketReceiveMultiplexer()
 {	
 	delete impl_;
@@ -540,6 +1000,31 @@ void SocketReceiveMultiplexer::DetachPeriodicTimerListener( TimerListener *liste
 	impl_->DetachPeriodicTimerListener( listener );
 }
 
+void SocketReceiveMultiplexer::SetReceiveBatchSize( int batchSize )
+{
+	impl_->SetReceiveBatchSize( batchSize );
+}
+
+int SocketReceiveMultiplexer::ReceiveBatchSize() const
+{
+	return impl_->ReceiveBatchSize();
+}
+
+void SocketReceiveMultiplexer::SetDrainUntilEmpty( bool drainUntilEmpty, int budget )
+{
+	impl_->SetDrainUntilEmpty( drainUntilEmpty, budget );
+}
+
+void SocketReceiveMultiplexer::SetBusyPoll( bool busyPoll, int idleMicroseconds )
+{
+	impl_->SetBusyPoll( busyPoll, idleMicroseconds );
+}
+
+void SocketReceiveMultiplexer::GetStatistics( SocketReceiveStatistics& statistics ) const
+{
+	impl_->GetStatistics( statistics );
+}
+
 void SocketReceiveMultiplexer::Run()
 {
 	impl_->Run();
@@ -1,81 +1,49 @@
+#include <algorithm>
 #include <codecvt>
+#include <sys/stat.h>
+#include <sys/types.h>
 #include <iomanip>
 #include <sstream>
 #include <fstream>
 #include <cmath>
 #include <chrono>
 
+#include "osc/OscStr4HashTable.h"
+
 #define MATH_PI   3.14159265358979323846264338327950288
 
 struct vmc_state
 {
 	bool loaded;
 	bool received;
+	bool loading; // the model is being parsed on the loader thread
 };
 
 struct vmc_options
 {
+	std::uint16_t port;
+	std::uint32_t receive_shards;
+	SocketReceiveBackend receive_backend;
+	unsigned long multicast_group; // IpEndpointName::ANY_ADDRESS for none
+	std::uint32_t packet_ring_slots; // 0 parses on the receive threads
+	std::uint32_t receive_buffer_bytes; // 0 keeps the system default
+	bool schedule_bundles; // apply bundles at their time tags
+	std::string model_cache_file; // empty keeps parsed models in memory only
 	std::string rootbone;
 	bool motion_in_place;
 	std::chrono::milliseconds interval;
+	int receive_batch_size;
+	int receive_drain_budget; // 0 returns to the wait after each batch
+	std::int64_t extrapolation_ns; // horizon of VmcPoseStore::at(), 0 holds the newest frame
 };
 
+// Number of humanoid bones in VRM 0.0, cgltf_vrm_humanoid_bone_bone_v0_0
+// values run from 0 to one less than this.
+static const std::size_t vrm_humanoid_bone_count = cgltf_vrm_humanoid_bone_bone_v0_0_upperChest + 1;
+
+// Humanoid bone => node of the model, nullptr for bones the model lacks.
 struct vmc_humanoid_mapping {
-	cgltf_node* hips;
-	cgltf_node* leftUpperLeg;
-	cgltf_node* rightUpperLeg;
-	cgltf_node* leftLowerLeg;
-	cgltf_node* rightLowerLeg;
-	cgltf_node* leftFoot;
-	cgltf_node* rightFoot;
-	cgltf_node* spine;
-	cgltf_node* chest;
-	cgltf_node* neck;
-	cgltf_node* head;
-	cgltf_node* leftShoulder;
-	cgltf_node* rightShoulder;
-	cgltf_node* leftUpperArm;
-	cgltf_node* rightUpperArm;
-	cgltf_node* leftLowerArm;
-	cgltf_node* rightLowerArm;
-	cgltf_node* leftHand;
-	cgltf_node* rightHand;
-	cgltf_node* leftToes;
-	cgltf_node* rightToes;
-	cgltf_node* leftEye;
-	cgltf_node* rightEye;
-	cgltf_node* jaw;
-	cgltf_node* leftThumbProximal;
-	cgltf_node* leftThumbIntermediate;
-	cgltf_node* leftThumbDistal;
-	cgltf_node* leftIndexProximal;
-	cgltf_node* leftIndexIntermediate;
-	cgltf_node* leftIndexDistal;
-	cgltf_node* leftMiddleProximal;
-	cgltf_node* leftMiddleIntermediate;
-	cgltf_node* leftMiddleDistal;
-	cgltf_node* leftRingProximal;
-	cgltf_node* leftRingIntermediate;
-	cgltf_node* leftRingDistal;
-	cgltf_node* leftLittleProximal;
-	cgltf_node* leftLittleIntermediate;
-	cgltf_node* leftLittleDistal;
-	cgltf_node* rightThumbProximal;
-	cgltf_node* rightThumbIntermediate;
-	cgltf_node* rightThumbDistal;
-	cgltf_node* rightIndexProximal;
-	cgltf_node* rightIndexIntermediate;
-	cgltf_node* rightIndexDistal;
-	cgltf_node* rightMiddleProximal;
-	cgltf_node* rightMiddleIntermediate;
-	cgltf_node* rightMiddleDistal;
-	cgltf_node* rightRingProximal;
-	cgltf_node* rightRingIntermediate;
-	cgltf_node* rightRingDistal;
-	cgltf_node* rightLittleProximal;
-	cgltf_node* rightLittleIntermediate;
-	cgltf_node* rightLittleDistal;
-	cgltf_node* upperChest;
+	cgltf_node* bones[vrm_humanoid_bone_count];
 };
 
 static vmc_humanoid_mapping vrm_get_humanoid_mapping(const cgltf_data* data)
@@ -84,346 +52,112 @@ static vmc_humanoid_mapping vrm_get_humanoid_mapping(const cgltf_data* data)
 
 	for (cgltf_size i = 0; i < data->vrm_v0_0.humanoid.humanBones_count; i++) {
 		const auto bone = data->vrm_v0_0.humanoid.humanBones[i];
-		switch (bone.bone) {
-		case  cgltf_vrm_humanoid_bone_bone_v0_0_hips:
-			mapping.hips = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftUpperLeg:
-			mapping.leftUpperLeg = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightUpperLeg:
-			mapping.rightUpperLeg = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftLowerLeg:
-			mapping.leftLowerLeg = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightLowerLeg:
-			mapping.rightLowerLeg = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftFoot:
-			mapping.leftFoot = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightFoot:
-			mapping.rightFoot = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_spine:
-			mapping.spine = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_chest:
-			mapping.chest = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_neck:
-			mapping.neck = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_head:
-			mapping.head = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftShoulder:
-			mapping.leftShoulder = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightShoulder:
-			mapping.rightShoulder = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftUpperArm:
-			mapping.leftUpperArm = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightUpperArm:
-			mapping.rightUpperArm = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftLowerArm:
-			mapping.leftLowerArm = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightLowerArm:
-			mapping.rightLowerArm = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftHand:
-			mapping.leftHand = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightHand:
-			mapping.rightHand = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftToes:
-			mapping.leftToes = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightToes:
-			mapping.rightToes = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftEye:
-			mapping.leftEye = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightEye:
-			mapping.rightEye = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_jaw:
-			mapping.jaw = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftThumbProximal:
-			mapping.leftThumbProximal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftThumbIntermediate:
-			mapping.leftThumbIntermediate = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftThumbDistal:
-			mapping.leftThumbDistal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftIndexProximal:
-			mapping.leftIndexProximal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftIndexIntermediate:
-			mapping.leftIndexIntermediate = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftIndexDistal:
-			mapping.leftIndexDistal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftMiddleProximal:
-			mapping.leftMiddleProximal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftMiddleIntermediate:
-			mapping.leftMiddleIntermediate = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftMiddleDistal:
-			mapping.leftMiddleDistal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftRingProximal:
-			mapping.leftRingProximal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftRingIntermediate:
-			mapping.leftRingIntermediate = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftRingDistal:
-			mapping.leftRingDistal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftLittleProximal:
-			mapping.leftLittleProximal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftLittleIntermediate:
-			mapping.leftLittleIntermediate = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_leftLittleDistal:
-			mapping.leftLittleDistal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightThumbProximal:
-			mapping.rightThumbProximal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightThumbIntermediate:
-			mapping.rightThumbIntermediate = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightThumbDistal:
-			mapping.rightThumbDistal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightIndexProximal:
-			mapping.rightIndexProximal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightIndexIntermediate:
-			mapping.rightIndexIntermediate = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightIndexDistal:
-			mapping.rightIndexDistal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightMiddleProximal:
-			mapping.rightMiddleProximal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightMiddleIntermediate:
-			mapping.rightMiddleIntermediate = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightMiddleDistal:
-			mapping.rightMiddleDistal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightRingProximal:
-			mapping.rightRingProximal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightRingIntermediate:
-			mapping.rightRingIntermediate = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightRingDistal:
-			mapping.rightRingDistal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightLittleProximal:
-			mapping.rightLittleProximal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightLittleIntermediate:
-			mapping.rightLittleIntermediate = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_rightLittleDistal:
-			mapping.rightLittleDistal = &data->nodes[bone.node];
-			break;
-		case cgltf_vrm_humanoid_bone_bone_v0_0_upperChest:
-			mapping.upperChest = &data->nodes[bone.node];
-			break;
+		if (static_cast<std::size_t>(bone.bone) < vrm_humanoid_bone_count) {
+			mapping.bones[bone.bone] = &data->nodes[bone.node];
 		}
 	}
 
 	return mapping;
 }
 
-static cgltf_node* vrm_get_humanoid_bone(const char* name, vmc_humanoid_mapping* mapping)
-{
-	if (std::strcmp(name, "Hips") == 0) {
-		return mapping->hips;
-	}
-	else if (std::strcmp(name, "LeftUpperLeg") == 0) {
-		return mapping->leftUpperLeg;
-	}
-	else if (std::strcmp(name, "RightUpperLeg") == 0) {
-		return mapping->rightUpperLeg;
-	}
-	else if (std::strcmp(name, "LeftLowerLeg") == 0) {
-		return mapping->leftLowerLeg;
-	}
-	else if (std::strcmp(name, "RightLowerLeg") == 0) {
-		return mapping->rightLowerLeg;
-	}
-	else if (std::strcmp(name, "LeftFoot") == 0) {
-		return mapping->leftFoot;
-	}
-	else if (std::strcmp(name, "RightFoot") == 0) {
-		return mapping->rightFoot;
-	}
-	else if (std::strcmp(name, "Spine") == 0) {
-		return mapping->spine;
-	}
-	else if (std::strcmp(name, "Chest") == 0) {
-		return mapping->chest;
-	}
-	else if (std::strcmp(name, "Neck") == 0) {
-		return mapping->neck;
-	}
-	else if (std::strcmp(name, "Head") == 0) {
-		return mapping->head;
-	}
-	else if (std::strcmp(name, "LeftShoulder") == 0) {
-		return mapping->leftShoulder;
-	}
-	else if (std::strcmp(name, "RightShoulder") == 0) {
-		return mapping->rightShoulder;
-	}
-	else if (std::strcmp(name, "LeftUpperArm") == 0) {
-		return mapping->leftUpperArm;
-	}
-	else if (std::strcmp(name, "RightUpperArm") == 0) {
-		return mapping->rightUpperArm;
-	}
-	else if (std::strcmp(name, "LeftLowerArm") == 0) {
-		return mapping->leftLowerArm;
-	}
-	else if (std::strcmp(name, "RightLowerArm") == 0) {
-		return mapping->rightLowerArm;
-	}
-	else if (std::strcmp(name, "LeftHand") == 0) {
-		return mapping->leftHand;
-	}
-	else if (std::strcmp(name, "RightHand") == 0) {
-		return mapping->rightHand;
-	}
-	else if (std::strcmp(name, "LeftToes") == 0) {
-		return mapping->leftToes;
-	}
-	else if (std::strcmp(name, "RightToes") == 0) {
-		return mapping->rightToes;
-	}
-	else if (std::strcmp(name, "LeftEye") == 0) {
-		return mapping->leftEye;
-	}
-	else if (std::strcmp(name, "RightEye") == 0) {
-		return mapping->rightEye;
-	}
-	else if (std::strcmp(name, "Jaw") == 0) {
-		return mapping->jaw;
-	}
-	else if (std::strcmp(name, "LeftThumbProximal") == 0) {
-		return mapping->leftThumbProximal;
-	}
-	else if (std::strcmp(name, "LeftThumbIntermediate") == 0) {
-		return mapping->leftThumbIntermediate;
-	}
-	else if (std::strcmp(name, "LeftThumbDistal") == 0) {
-		return mapping->leftThumbDistal;
-	}
-	else if (std::strcmp(name, "LeftIndexProximal") == 0) {
-		return mapping->leftIndexProximal;
-	}
-	else if (std::strcmp(name, "LeftIndexIntermediate") == 0) {
-		return mapping->leftIndexIntermediate;
-	}
-	else if (std::strcmp(name, "LeftIndexDistal") == 0) {
-		return mapping->leftIndexDistal;
-	}
-	else if (std::strcmp(name, "LeftMiddleProximal") == 0) {
-		return mapping->leftMiddleProximal;
-	}
-	else if (std::strcmp(name, "LeftMiddleIntermediate") == 0) {
-		return mapping->leftMiddleIntermediate;
-	}
-	else if (std::strcmp(name, "LeftMiddleDistal") == 0) {
-		return mapping->leftMiddleDistal;
-	}
-	else if (std::strcmp(name, "LeftRingProximal") == 0) {
-		return mapping->leftRingProximal;
-	}
-	else if (std::strcmp(name, "LeftRingIntermediate") == 0) {
-		return mapping->leftRingIntermediate;
-	}
-	else if (std::strcmp(name, "LeftRingDistal") == 0) {
-		return mapping->leftRingDistal;
-	}
-	else if (std::strcmp(name, "LeftLittleProximal") == 0) {
-		return mapping->leftLittleProximal;
-	}
-	else if (std::strcmp(name, "LeftLittleIntermediate") == 0) {
-		return mapping->leftLittleIntermediate;
-	}
-	else if (std::strcmp(name, "LeftLittleDistal") == 0) {
-		return mapping->leftLittleDistal;
-	}
-	else if (std::strcmp(name, "RightThumbProximal") == 0) {
-		return mapping->rightThumbProximal;
-	}
-	else if (std::strcmp(name, "RightThumbIntermediate") == 0) {
-		return mapping->rightThumbIntermediate;
-	}
-	else if (std::strcmp(name, "RightThumbDistal") == 0) {
-		return mapping->rightThumbDistal;
-	}
-	else if (std::strcmp(name, "RightIndexProximal") == 0) {
-		return mapping->rightIndexProximal;
-	}
-	else if (std::strcmp(name, "RightIndexIntermediate") == 0) {
-		return mapping->rightIndexIntermediate;
-	}
-	else if (std::strcmp(name, "RightIndexDistal") == 0) {
-		return mapping->rightIndexDistal;
-	}
-	else if (std::strcmp(name, "RightMiddleProximal") == 0) {
-		return mapping->rightMiddleProximal;
-	}
-	else if (std::strcmp(name, "RightMiddleIntermediate") == 0) {
-		return mapping->rightMiddleIntermediate;
-	}
-	else if (std::strcmp(name, "RightMiddleDistal") == 0) {
-		return mapping->rightMiddleDistal;
-	}
-	else if (std::strcmp(name, "RightRingProximal") == 0) {
-		return mapping->rightRingProximal;
-	}
-	else if (std::strcmp(name, "RightRingIntermediate") == 0) {
-		return mapping->rightRingIntermediate;
-	}
-	else if (std::strcmp(name, "RightRingDistal") == 0) {
-		return mapping->rightRingDistal;
-	}
-	else if (std::strcmp(name, "RightLittleProximal") == 0) {
-		return mapping->rightLittleProximal;
-	}
-	else if (std::strcmp(name, "RightLittleIntermediate") == 0) {
-		return mapping->rightLittleIntermediate;
+// Bone names VMC senders use, in cgltf_vrm_humanoid_bone_bone_v0_0 order.
+static const char* const vmc_humanoid_bone_names[vrm_humanoid_bone_count] = {
+	"Hips",
+	"LeftUpperLeg",
+	"RightUpperLeg",
+	"LeftLowerLeg",
+	"RightLowerLeg",
+	"LeftFoot",
+	"RightFoot",
+	"Spine",
+	"Chest",
+	"Neck",
+	"Head",
+	"LeftShoulder",
+	"RightShoulder",
+	"LeftUpperArm",
+	"RightUpperArm",
+	"LeftLowerArm",
+	"RightLowerArm",
+	"LeftHand",
+	"RightHand",
+	"LeftToes",
+	"RightToes",
+	"LeftEye",
+	"RightEye",
+	"Jaw",
+	"LeftThumbProximal",
+	"LeftThumbIntermediate",
+	"LeftThumbDistal",
+	"LeftIndexProximal",
+	"LeftIndexIntermediate",
+	"LeftIndexDistal",
+	"LeftMiddleProximal",
+	"LeftMiddleIntermediate",
+	"LeftMiddleDistal",
+	"LeftRingProximal",
+	"LeftRingIntermediate",
+	"LeftRingDistal",
+	"LeftLittleProximal",
+	"LeftLittleIntermediate",
+	"LeftLittleDistal",
+	"RightThumbProximal",
+	"RightThumbIntermediate",
+	"RightThumbDistal",
+	"RightIndexProximal",
+	"RightIndexIntermediate",
+	"RightIndexDistal",
+	"RightMiddleProximal",
+	"RightMiddleIntermediate",
+	"RightMiddleDistal",
+	"RightRingProximal",
+	"RightRingIntermediate",
+	"RightRingDistal",
+	"RightLittleProximal",
+	"RightLittleIntermediate",
+	"RightLittleDistal",
+	"UpperChest",
+};
+
+// Perfect hash from VMC bone name to humanoid bone, the same table the
+// listener routes addresses with. Built once, a lookup then hashes the
+// name and compares it with the one candidate.
+class vmc_humanoid_bone_table {
+public:
+	static const vmc_humanoid_bone_table& instance()
+	{
+		static const vmc_humanoid_bone_table table;
+		return table;
 	}
-	else if (std::strcmp(name, "RightLittleDistal") == 0) {
-		return mapping->rightLittleDistal;
+
+	// name must be zero padded to a multiple of 4 bytes, as OSC string
+	// arguments are in the received packet.
+	bool find(const char* name, cgltf_vrm_humanoid_bone_bone_v0_0* bone) const
+	{
+		const int index = names.Find(name);
+		if (index < 0) {
+			return false;
+		}
+		*bone = static_cast<cgltf_vrm_humanoid_bone_bone_v0_0>(index);
+		return true;
 	}
-	else if (std::strcmp(name, "UpperChest") == 0) {
-		return mapping->upperChest;
+
+private:
+	vmc_humanoid_bone_table()
+	{
+		for (std::size_t i = 0; i < vrm_humanoid_bone_count; i++) {
+			names.Add(vmc_humanoid_bone_names[i]);
+		}
 	}
-	return nullptr;
+
+	osc::Str4HashTable names; // indexed by humanoid bone
+};
+
+// Resolves a VMC bone name such as "LeftUpperArm", zero padded as an OSC
+// string, to its humanoid bone.
+static bool vmc_find_humanoid_bone(const char* name, cgltf_vrm_humanoid_bone_bone_v0_0* bone)
+{
+	return vmc_humanoid_bone_table::instance().find(name, bone);
 }
 
 static bool char_equals_ignoreCase(char& c1, char& c2)
@@ -460,13 +194,49 @@ static bool vrm_get_root_bone(cgltf_data* data, std::string& known_name, cgltf_s
 	return false;
 }
 
-static cgltf_result wstring_vrm_file_read(const struct cgltf_memory_options* memory_options, const struct cgltf_file_options* file_options, const std::wstring path, cgltf_size* size, void** data)
+static FILE* vrm_file_open(const char* path, const char* mode = "rb")
+{
+#if defined(_WIN32)
+	std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+	return _wfopen(converter.from_bytes(path).c_str(), converter.from_bytes(mode).c_str());
+#else
+	return fopen(path, mode);
+#endif
+}
+
+// Size and modification time of a file, the time in nanoseconds where the
+// platform keeps them and in seconds elsewhere.
+static bool vrm_file_stat(const char* path, std::uint64_t* size, std::int64_t* mtime)
+{
+#if defined(_WIN32)
+	std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+	struct _stat64 info;
+	if (_wstat64(converter.from_bytes(path).c_str(), &info) != 0) {
+		return false;
+	}
+	*mtime = static_cast<std::int64_t>(info.st_mtime);
+#else
+	struct stat info;
+	if (stat(path, &info) != 0) {
+		return false;
+	}
+#if defined(__linux__)
+	*mtime = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#else
+	*mtime = static_cast<std::int64_t>(info.st_mtime);
+#endif
+#endif
+	*size = static_cast<std::uint64_t>(info.st_size);
+	return true;
+}
+
+static cgltf_result vrm_file_read(const struct cgltf_memory_options* memory_options, const struct cgltf_file_options* file_options, const char* path, cgltf_size* size, void** data)
 {
 	(void)file_options;
 	void* (*memory_alloc)(void*, cgltf_size) = memory_options->alloc ? memory_options->alloc : &cgltf_default_alloc;
 	void (*memory_free)(void*, void*) = memory_options->free ? memory_options->free : &cgltf_default_free;
 
-	FILE* file = _wfopen(path.c_str(), L"rb");
+	FILE* file = vrm_file_open(path);
 
 	if (!file)
 	{
@@ -518,9 +288,3 @@ static cgltf_result wstring_vrm_file_read(const struct cgltf_memory_options* mem
 
 	return cgltf_result_success;
 }
-
-static cgltf_result vrm_file_read(const struct cgltf_memory_options* memory_options, const struct cgltf_file_options* file_options, const char* path, cgltf_size* size, void** data)
-{
-	std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
-	return wstring_vrm_file_read(memory_options, file_options, converter.from_bytes(path), size, data);
-}
@@ -1,238 +1,1508 @@
 #define CGLTF_IMPLEMENTATION
 #define CGLTF_VRM_v0_0_IMPLEMENTATION
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <chrono>
+#include <memory>
 #include <thread>
 #include <mutex>
-#include <unordered_map>
+#include <vector>
+
+// SSE2 is part of every x86-64 target, elsewhere rotations are blended one
+// at a time.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOTIONCLIENT_SIMD_SSE2
+#include <emmintrin.h>
+#endif
 
 #include "motionclient.h"
 #include <foundation/math.inl>
 
-#include "osc/OscPacketListener.h"
+#include "osc/MessageMappingOscPacketListener.h"
 #include "ip/UdpSocket.h"
-#include "osc/OscOutboundPacketStream.h"
+#include "ip/PacketRing.h"
+#include "ip/EndpointDemultiplexer.h"
 #include "cgltf/cgltf.h"
 #include "cgltf_func.inl"
 
-static std::mutex motionclient_lock_guard;
 static struct tm_logger_api* tm_logger_api = nullptr;
 static struct tm_string_repository_i* tm_string_repository = nullptr;
 
-class VmcPacketListener : public osc::OscPacketListener {
+// Blend weight that makes normalized lerp follow slerp to within about
+// 2e-3 radians, d being the cosine of the angle between the rotations
+// (after zeux.io, "Approximating slerp").
+static inline float vmc_slerp_weight(float t, float d)
+{
+	const float a = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+	const float b = 0.848013f + d * (-1.06021f + d * 0.215638f);
+	const float k = a * (t - 0.5f) * (t - 0.5f) + b;
+	return t + t * (t - 0.5f) * (t - 1.0f) * k;
+}
+
+// Turns count rotations from a towards b by t, along the shorter arc.
+static void vmc_slerp_rotations(const tm_vec4_t* a, const tm_vec4_t* b, float t, tm_vec4_t* out, std::size_t count)
+{
+	std::size_t i = 0;
+#if defined(MOTIONCLIENT_SIMD_SSE2)
+	// four bones at a time, transposed so each register holds one component
+	const __m128 sign_bit = _mm_set1_ps(-0.0f);
+	const __m128 vt = _mm_set1_ps(t);
+	const __m128 vt_half = _mm_set1_ps(t - 0.5f);
+	const __m128 vt_cubic = _mm_set1_ps(t * (t - 0.5f) * (t - 1.0f));
+	for (; i + 4 <= count; i += 4) {
+		__m128 ax = _mm_loadu_ps(&a[i].x), ay = _mm_loadu_ps(&a[i + 1].x), az = _mm_loadu_ps(&a[i + 2].x), aw = _mm_loadu_ps(&a[i + 3].x);
+		__m128 bx = _mm_loadu_ps(&b[i].x), by = _mm_loadu_ps(&b[i + 1].x), bz = _mm_loadu_ps(&b[i + 2].x), bw = _mm_loadu_ps(&b[i + 3].x);
+		_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+		_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+		const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+			_mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+		const __m128 flip = _mm_and_ps(dot, sign_bit);
+		bx = _mm_xor_ps(bx, flip);
+		by = _mm_xor_ps(by, flip);
+		bz = _mm_xor_ps(bz, flip);
+		bw = _mm_xor_ps(bw, flip);
+
+		// vmc_slerp_weight() for each bone
+		const __m128 d = _mm_andnot_ps(sign_bit, dot);
+		__m128 wa = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)));
+		wa = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, wa));
+		wa = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, wa));
+		__m128 wb = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+		wb = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, wb));
+		const __m128 k = _mm_add_ps(_mm_mul_ps(wa, _mm_mul_ps(vt_half, vt_half)), wb);
+		const __m128 w = _mm_add_ps(vt, _mm_mul_ps(vt_cubic, k));
+
+		__m128 rx = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(bx, ax), w));
+		__m128 ry = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(by, ay), w));
+		__m128 rz = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(bz, az), w));
+		__m128 rw = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(bw, aw), w));
+		// normalize with the reciprocal square root estimate and a Newton step
+		const __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)),
+			_mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw)));
+		__m128 scale = _mm_rsqrt_ps(length2);
+		scale = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), scale),
+			_mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(length2, _mm_mul_ps(scale, scale))));
+		rx = _mm_mul_ps(rx, scale);
+		ry = _mm_mul_ps(ry, scale);
+		rz = _mm_mul_ps(rz, scale);
+		rw = _mm_mul_ps(rw, scale);
+
+		_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+		_mm_storeu_ps(&out[i].x, rx);
+		_mm_storeu_ps(&out[i + 1].x, ry);
+		_mm_storeu_ps(&out[i + 2].x, rz);
+		_mm_storeu_ps(&out[i + 3].x, rw);
+	}
+#endif
+	for (; i < count; i++) {
+		const float dot = a[i].x * b[i].x + a[i].y * b[i].y + a[i].z * b[i].z + a[i].w * b[i].w;
+		const float sign = dot < 0 ? -1.0f : 1.0f;
+		const float w = vmc_slerp_weight(t, dot * sign);
+		const tm_vec4_t r = {
+			a[i].x + (b[i].x * sign - a[i].x) * w,
+			a[i].y + (b[i].y * sign - a[i].y) * w,
+			a[i].z + (b[i].z * sign - a[i].z) * w,
+			a[i].w + (b[i].w * sign - a[i].w) * w };
+		const float length = std::sqrt(r.x * r.x + r.y * r.y + r.z * r.z + r.w * r.w);
+		out[i] = { r.x / length, r.y / length, r.z / length, r.w / length };
+	}
+}
+
+// Carries count rotations on past b along the arc from a to b, t counting
+// turns from a to b (t = 1 gives b). Small turns are extrapolated linearly,
+// where acos loses precision.
+static void vmc_extrapolate_rotations(const tm_vec4_t* a, const tm_vec4_t* b, float t, tm_vec4_t* out, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++) {
+		const float dot = a[i].x * b[i].x + a[i].y * b[i].y + a[i].z * b[i].z + a[i].w * b[i].w;
+		const float sign = dot < 0 ? -1.0f : 1.0f;
+		const float d = dot * sign;
+		float wa, wb;
+		if (d > 0.9995f) {
+			wa = 1.0f - t;
+			wb = t * sign;
+		}
+		else {
+			const float angle = std::acos(d);
+			const float s = std::sin(angle);
+			wa = std::sin((1.0f - t) * angle) / s;
+			wb = std::sin(t * angle) / s * sign;
+		}
+		const tm_vec4_t r = {
+			a[i].x * wa + b[i].x * wb,
+			a[i].y * wa + b[i].y * wb,
+			a[i].z * wa + b[i].z * wb,
+			a[i].w * wa + b[i].w * wb };
+		const float length = std::sqrt(r.x * r.x + r.y * r.y + r.z * r.z + r.w * r.w);
+		out[i] = { r.x / length, r.y / length, r.z / length, r.w / length };
+	}
+}
+
+// Translations are lerped, or extrapolated for t > 1.
+static void vmc_lerp_translations(const tm_vec3_t* a, const tm_vec3_t* b, float t, tm_vec3_t* out, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++) {
+		out[i] = { a[i].x + (b[i].x - a[i].x) * t, a[i].y + (b[i].y - a[i].y) * t, a[i].z + (b[i].z - a[i].z) * t };
+	}
+}
+
+// Maps a sender's frame times onto the steady_clock timeline, so frames
+// are spaced as the sender made them rather than as the network delivered
+// them. The clock offset is the smallest arrival minus sender time seen,
+// that of the least delayed packet, rising by a fraction of the gap on
+// later frames so it follows a sender clock that runs slow. A sender time
+// more than resync_ns off the offset means the sender restarted or its
+// clock stepped, and the offset is taken afresh.
+class VmcFrameClock {
 public:
-	VmcPacketListener(const vmc_options& options) : osc::OscPacketListener()
-		, options(options)
-		, vrmdata(nullptr)
-		, state{ false, false }
-		, humanoid_mapping{}
-		, transform_data{ 0, nullptr, nullptr, nullptr }
+	// Clock a sender time is on.
+	enum Source {
+		none, // no sender time, frames are stamped with their arrival
+		vmc_time, // /VMC/Ext/T
+		time_tag, // the bundle time tag
+	};
+
+	static const int64_t resync_ns = 1000000000;
+	static const int64_t creep_divisor = 256;
+
+	VmcFrameClock()
+		: source(none)
+		, offset_ns(0)
 	{
-		TM_LOG("[INFO] VmcPacketListener created");
 	}
 
-	virtual ~VmcPacketListener()
+	// Local time of a frame the sender made at sender_time_ns which arrived
+	// at arrival_time_ns. Never later than the arrival.
+	int64_t stamp(Source frame_source, int64_t sender_time_ns, int64_t arrival_time_ns)
 	{
-		TM_LOG("[INFO] VmcPacketListener cleaning up");
-		for (const auto& iter : hash_to_index_map) {
-			tm_string_repository->remove(tm_string_repository->inst, iter.first);
+		if (frame_source == none) {
+			return arrival_time_ns;
 		}
-		TM_LOG("[INFO] VmcPacketListener destroyed");
+		const int64_t sample = arrival_time_ns - sender_time_ns;
+		if (frame_source != source || sample < offset_ns - resync_ns || sample > offset_ns + resync_ns) {
+			source = frame_source;
+			offset_ns = sample;
+		}
+		else if (sample < offset_ns) {
+			offset_ns = sample;
+		}
+		else {
+			offset_ns += (sample - offset_ns) / creep_divisor;
+		}
+		return sender_time_ns + offset_ns;
 	}
 
-	virtual void ProcessMessage(const osc::ReceivedMessage& m,
-		const IpEndpointName& remoteEndpoint) override
+private:
+	Source source;
+	int64_t offset_ns;
+};
+
+// Pose storage of one sender. Each humanoid bone has a
+// fixed slot indexed by its cgltf_vrm_humanoid_bone_bone_v0_0 value, with
+// the root bone after them, so writing a bone is a plain array store. A
+// listener names the slots with string repository hashes of its model's
+// nodes when it loads the model, slots nobody named keep hash 0.
+// Listeners write bones into a working pose, and publish() copies it into a triple
+// buffer from which motionclient_poll() takes the newest complete frame,
+// so neither side waits for the other. Only the listener of the sender
+// writes the store, on the thread parsing its datagrams.
+//
+// publish() also records each frame in a history ring, from which at()
+// interpolates the pose at a given time to play poses out with a delay
+// that hides network and frame rate jitter. Frames are placed by the
+// sender's time where it sends one, mapped through a VmcFrameClock, and by
+// their arrival otherwise. Past the newest frame at() can dead-reckon
+// instead, for late or lost frames.
+//
+// Every sender has a store of its own, so the frames of two senders never
+// share a history or a VmcFrameClock.
+// The ring's lock is held only while publish() copies a frame in and at()
+// searches it and copies out the two frames it blends, the blend runs
+// after at() releases it.
+class VmcPoseStore {
+public:
+	static const uint8_t root_slot = vrm_humanoid_bone_count;
+	static const uint8_t capacity = root_slot + 1;
+
+	// Frames kept for at(), about a second at 60 frames per second.
+	static const std::size_t history_capacity = 64;
+
+	// Shortest time between the two frames bone velocities are taken from,
+	// so a frame split over several bundles doesn't give absurd ones.
+	static const int64_t min_velocity_interval_ns = 5000000;
+
+	// extrapolation_ns bounds how far at() extrapolates past the newest
+	// frame, 0 holds the newest frame.
+	explicit VmcPoseStore(int64_t extrapolation_ns)
+		: extrapolation_ns(extrapolation_ns)
+		, hashes{}
+		, sequence(0)
+		, write_index(0)
+		, ready(1)
+		, read_index(2)
+		, published(false)
+		, history_count(0)
+		, history_next(0)
+		, blended_from(0)
+		, blended_to(0)
+		, blended_weight(-1.0f)
+		, blended_sequence(0)
 	{
-		try {
-			auto arg = m.ArgumentsBegin();
-			const auto address = m.AddressPattern();
-			if (std::strcmp(address, "/VMC/PING") == 0) {
-				return;
+		std::fill(translations, translations + capacity, tm_vec3_t{ 0, 0, 0 });
+		std::fill(rotations, rotations + capacity, tm_vec4_t{ 0, 0, 0, 1 });
+		for (auto& frame : frames) {
+			frame.data = { 0, frame.hashes, frame.translations, frame.rotations, 0, 0, 0, 0 };
+		}
+		blended.data = { 0, blended.hashes, blended.translations, blended.rotations, 0, 0, 0, 0 };
+		for (auto& held : held_frames) {
+			held.frame = 0; // frames count from 1
+		}
+	}
+
+	// Names a slot and sets its pose.
+	void addBone(uint8_t slot, uint64_t hash, const tm_vec3_t& translation, const tm_vec4_t& rotation)
+	{
+		assert(slot < capacity);
+		hashes[slot] = hash;
+		translations[slot] = translation;
+		rotations[slot] = rotation;
+	}
+
+	void writeBone(uint8_t slot, const tm_vec3_t& translation, const tm_vec4_t& rotation)
+	{
+		assert(slot < capacity);
+		translations[slot] = translation;
+		rotations[slot] = rotation;
+	}
+
+	// Hands the working pose to the reader as a new frame. The frame is
+	// recorded at sender_time_ns on the sender's clock when it has one.
+	void publish(int64_t arrival_time_ns, VmcFrameClock::Source clock = VmcFrameClock::none, int64_t sender_time_ns = 0)
+	{
+		auto& frame = frames[write_index];
+		std::copy(hashes, hashes + capacity, frame.hashes);
+		std::copy(translations, translations + capacity, frame.translations);
+		std::copy(rotations, rotations + capacity, frame.rotations);
+		frame.data.availableCount = capacity;
+		frame.data.arrivalTimeNs = arrival_time_ns;
+		frame.data.frame = ++sequence;
+		write_index = ready.exchange(write_index | fresh_frame, std::memory_order_acq_rel) & frame_index_mask;
+		published.store(true, std::memory_order_relaxed);
+		const int64_t frame_time_ns = frame_clock.stamp(clock, sender_time_ns, arrival_time_ns);
+
+		std::lock_guard<std::mutex> history_guard(history_lock);
+		auto& entry = history[history_next];
+		std::copy(hashes, hashes + capacity, entry.hashes);
+		std::copy(translations, translations + capacity, entry.translations);
+		std::copy(rotations, rotations + capacity, entry.rotations);
+		entry.time_ns = frame_time_ns;
+		entry.arrival_time_ns = arrival_time_ns;
+		entry.frame = sequence;
+		history_next = (history_next + 1) % history_capacity;
+		if (history_count < history_capacity) {
+			history_count++;
+		}
+	}
+
+	// The pose at time_ns on the steady_clock timeline. Between two recorded
+	// frames rotations are slerped and translations lerped, before the
+	// oldest frame that frame is returned. After the newest frame each bone
+	// carries on at its velocity over the last frames, slowing down to stop
+	// at the extrapolation horizon, or the newest frame is held without
+	// one. The pose is recomputed only when the frames or the weight
+	// change, and stays unchanged until the next call; only one thread may
+	// call it.
+	const motion_listener_transform_data_t* at(int64_t time_ns)
+	{
+		std::unique_lock<std::mutex> history_guard(history_lock);
+		const HistoryFrame* before = nullptr;
+		const HistoryFrame* after = nullptr;
+		for (std::size_t i = 0; i < history_count; i++) {
+			const auto& entry = history[i];
+			if (entry.time_ns <= time_ns) {
+				if (before == nullptr || entry.time_ns > before->time_ns
+					|| (entry.time_ns == before->time_ns && entry.frame > before->frame)) {
+					before = &entry;
+				}
+			}
+			else if (after == nullptr || entry.time_ns < after->time_ns) {
+				after = &entry;
 			}
-			else if (!state.loaded && std::strcmp(address, "/VMC/Ext/OK") == 0 && arg->IsInt32()) {
-				const auto loaded = (arg++)->AsInt32Unchecked();
-				const auto calibrated = (arg++)->AsInt32Unchecked();
-				if (loaded == 1 && calibrated == 3) {
-					state.loaded = true;
+		}
+		if (before == nullptr && after == nullptr) {
+			return &blended.data;
+		}
+
+		const HistoryFrame* from = (before != nullptr) ? before : after;
+		const HistoryFrame* to = (after != nullptr) ? after : before;
+		float weight = 0;
+		int64_t ahead_ns = 0;
+		if (to->time_ns > from->time_ns) {
+			weight = static_cast<float>(static_cast<double>(time_ns - from->time_ns) / static_cast<double>(to->time_ns - from->time_ns));
+		}
+		else if (after == nullptr && extrapolation_ns > 0 && time_ns > before->time_ns) {
+			const HistoryFrame* previous = nullptr;
+			for (std::size_t i = 0; i < history_count; i++) {
+				const auto& entry = history[i];
+				if (entry.time_ns <= before->time_ns - min_velocity_interval_ns
+					&& (previous == nullptr || entry.time_ns > previous->time_ns)) {
+					previous = &entry;
 				}
 			}
-			else if (!state.received && state.loaded && std::strcmp(address, "/VMC/Ext/VRM") == 0) {
-				// Collect bone information. This should be done only once.
-				if (arg->IsString() && !state.received) {
-					const auto value = (arg++)->AsStringUnchecked();
-					if (strlen(value) > 0) {
-
-						cgltf_options parse_options = {};
-						parse_options.file.read = &vrm_file_read;
-
-						if (vrmdata != nullptr) {
-							cgltf_free(vrmdata);
-						}
-
-						const auto result = cgltf_parse_file(&parse_options, value, &vrmdata);
-
-						if (result == cgltf_result_success) {
-
-							// Constructs humanoid-bone => node mapping 
-							humanoid_mapping = vrm_get_humanoid_mapping(vrmdata);
-							std::lock_guard<std::mutex> lock(motionclient_lock_guard);
-							transform_data.availableCount = 0;
-
-							assert(vrmdata->vrm_v0_0.humanoid.humanBones_count < 255);
-
-							uint8_t stored_index = 0;
-							cgltf_size rootbone_index;
-							const auto rootbone_found = vrm_get_root_bone(vrmdata, options.rootbone, &rootbone_index);
-
-							// initialize hashes
-							const auto availableCount = static_cast<uint8_t>(vrmdata->vrm_v0_0.humanoid.humanBones_count + (rootbone_found ? 1 : 0));
-							transform_data.hashes = new uint64_t[availableCount];
-							transform_data.rotations = new tm_vec4_t[availableCount];
-							transform_data.translations = new tm_vec3_t[availableCount];
-
-							if (rootbone_found) {
-								const auto rootnode = vrmdata->nodes[rootbone_index];
-
-								const auto rootbone_hash = tm_string_repository->add(tm_string_repository->inst, options.rootbone.c_str());
-								hash_map.emplace(options.rootbone, rootbone_hash);
-								hash_to_index_map.emplace(rootbone_hash, stored_index);
-								transform_data.hashes[stored_index] = rootbone_hash;
-								transform_data.rotations[stored_index] = { rootnode.rotation[0], rootnode.rotation[1], rootnode.rotation[2], rootnode.rotation[3] };
-								transform_data.translations[stored_index] = { rootnode.translation[0], rootnode.translation[1], rootnode.translation[2] };
-								stored_index++;
-							}
-
-							for (cgltf_size i = 0; i < vrmdata->vrm_v0_0.humanoid.humanBones_count; i++) {
-								const auto bone = vrmdata->vrm_v0_0.humanoid.humanBones[i];
-								const auto name = vrmdata->nodes[bone.node].name;
-								const auto stored_hash = tm_string_repository->add(tm_string_repository->inst, name);
-								hash_map.emplace(name, stored_hash);
-								hash_to_index_map.emplace(stored_hash, stored_index);
-
-								transform_data.hashes[stored_index] = stored_hash;
-								transform_data.rotations[stored_index] = { 0, 0, 0, 1 };
-								transform_data.translations[stored_index] = { 0, 0, 0 };
-
-								// Consider first bone as a root bone when actual root bone is not found
-								if (i == 0 && !rootbone_found) {
-									options.rootbone = name;
-								}
-
-								stored_index++;
-							}
-
-							transform_data.availableCount = availableCount;
-
-							TM_LOG("[INFO] VmcPacketListener starts recording...");
-							state.received = true;
-						}
+			if (previous != nullptr) {
+				// the speed falls linearly to 0 at the horizon
+				ahead_ns = std::min(time_ns - before->time_ns, extrapolation_ns);
+				const double travelled_ns = ahead_ns - 0.5 * static_cast<double>(ahead_ns) * ahead_ns / extrapolation_ns;
+				from = previous;
+				weight = static_cast<float>(1.0 + travelled_ns / static_cast<double>(before->time_ns - previous->time_ns));
+			}
+		}
+
+		if (from->frame != blended_from || to->frame != blended_to || weight != blended_weight) {
+			blended_from = from->frame;
+			blended_to = to->frame;
+			blended_weight = weight;
+			holdFrames(&from, &to);
+			history_guard.unlock();
+
+			std::copy(to->hashes, to->hashes + capacity, blended.hashes);
+			vmc_lerp_translations(from->translations, to->translations, weight, blended.translations, capacity);
+			uint8_t extrapolated = 0;
+			if (ahead_ns > 0) {
+				vmc_extrapolate_rotations(from->rotations, to->rotations, weight, blended.rotations, capacity);
+				for (uint8_t i = 0; i < capacity; i++) {
+					if (std::memcmp(&from->translations[i], &to->translations[i], sizeof(tm_vec3_t)) != 0
+						|| std::memcmp(&from->rotations[i], &to->rotations[i], sizeof(tm_vec4_t)) != 0) {
+						extrapolated++;
 					}
 				}
 			}
-			else if (state.received && std::strcmp(address, "/VMC/Ext/Root/Pos") == 0) {
-
-				const auto name = (arg++)->AsStringUnchecked();
-				const auto px = (arg++)->AsFloatUnchecked();
-				const auto py = (arg++)->AsFloatUnchecked();
-				const auto pz = (arg++)->AsFloatUnchecked();
-				const auto qx = (arg++)->AsFloatUnchecked();
-				const auto qy = (arg++)->AsFloatUnchecked();
-				const auto qz = (arg++)->AsFloatUnchecked();
-				const auto qw = (arg++)->AsFloatUnchecked();
-
-				(void)name; // unused
-
-				const auto hash  = getStringHash(options.rootbone);
-				const auto index = getStringIndex(hash);
-
-				{
-					std::lock_guard<std::mutex> lock(motionclient_lock_guard);
-					transform_data.hashes[index] = hash; // "Armature" etc
-					transform_data.translations[index] = { px, py, pz };
-					transform_data.rotations[index] = { qx, -qy, -qz, qw };
+			else {
+				vmc_slerp_rotations(from->rotations, to->rotations, weight, blended.rotations, capacity);
+			}
+			blended.data.availableCount = capacity;
+			blended.data.arrivalTimeNs = to->arrival_time_ns;
+			blended.data.frame = ++blended_sequence;
+			blended.data.extrapolatedNs = ahead_ns;
+			blended.data.extrapolatedCount = extrapolated;
+		}
+		return &blended.data;
+	}
+
+	// The newest published frame. It isn't written again until the next
+	// call, and only one thread may take frames.
+	const motion_listener_transform_data_t* latest()
+	{
+		if (ready.load(std::memory_order_relaxed) & fresh_frame) {
+			read_index = ready.exchange(read_index, std::memory_order_acq_rel) & frame_index_mask;
+		}
+		return &frames[read_index].data;
+	}
+
+	// Whether a frame has been published, from any thread.
+	bool hasFrames() const
+	{
+		return published.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct PoseFrame {
+		uint64_t hashes[capacity];
+		tm_vec3_t translations[capacity];
+		tm_vec4_t rotations[capacity];
+		motion_listener_transform_data_t data;
+	};
+
+	struct HistoryFrame {
+		uint64_t hashes[capacity];
+		tm_vec3_t translations[capacity];
+		tm_vec4_t rotations[capacity];
+		int64_t time_ns; // where the frame is placed on the timeline
+		int64_t arrival_time_ns;
+		uint64_t frame;
+	};
+
+	// ready holds the index of the frame between writer and reader, with
+	// fresh_frame set when the reader hasn't taken it yet.
+	static const unsigned frame_index_mask = 3;
+	static const unsigned fresh_frame = 4;
+
+	// Points from and to at copies of the frames they point at in the
+	// history, so they can be blended without the lock. A frame already
+	// held from an earlier call isn't copied again.
+	void holdFrames(const HistoryFrame** from, const HistoryFrame** to)
+	{
+		HistoryFrame* from_copy = heldFrame((*from)->frame);
+		HistoryFrame* to_copy = heldFrame((*to)->frame);
+		if (from_copy == nullptr) {
+			from_copy = (to_copy == &held_frames[0]) ? &held_frames[1] : &held_frames[0];
+			*from_copy = **from;
+		}
+		if ((*to)->frame == (*from)->frame) {
+			to_copy = from_copy;
+		}
+		else if (to_copy == nullptr) {
+			to_copy = (from_copy == &held_frames[0]) ? &held_frames[1] : &held_frames[0];
+			*to_copy = **to;
+		}
+		*from = from_copy;
+		*to = to_copy;
+	}
+
+	HistoryFrame* heldFrame(uint64_t frame)
+	{
+		for (auto& held : held_frames) {
+			if (held.frame == frame) {
+				return &held;
+			}
+		}
+		return nullptr;
+	}
+
+	const int64_t extrapolation_ns;
+	uint64_t hashes[capacity];
+	tm_vec3_t translations[capacity];
+	tm_vec4_t rotations[capacity];
+	uint64_t sequence;
+	VmcFrameClock frame_clock;
+
+	PoseFrame frames[3];
+	unsigned write_index;
+	std::atomic<unsigned> ready;
+	unsigned read_index;
+	std::atomic<bool> published;
+
+	std::mutex history_lock;
+	HistoryFrame history[history_capacity];
+	std::size_t history_count;
+	std::size_t history_next; // slot the next frame is recorded in
+
+	// at() result, reused while the frames and weight stay the same, and
+	// the frames it was blended from
+	PoseFrame blended;
+	HistoryFrame held_frames[2];
+	uint64_t blended_from;
+	uint64_t blended_to;
+	float blended_weight;
+	uint64_t blended_sequence;
+};
+
+// Humanoid bones of a VRM model, all the listener keeps of the model.
+struct VmcModel {
+	VmcModel()
+		: first_bone(VmcPoseStore::capacity)
+		, rootbone_found(false)
+		, root_translation{ 0, 0, 0 }
+		, root_rotation{ 0, 0, 0, 1 }
+	{
+	}
+
+	// Node name of each humanoid bone, empty for bones the model lacks.
+	std::string bone_names[vrm_humanoid_bone_count];
+
+	// Slot of the first humanoid bone the model lists, which takes root
+	// poses when there is no root bone. VmcPoseStore::capacity for none.
+	uint8_t first_bone;
+
+	// Rest pose of the root bone when the model has one.
+	bool rootbone_found;
+	tm_vec3_t root_translation;
+	tm_vec4_t root_rotation;
+};
+
+// Parses a model file, false when it can't be parsed.
+static bool vmc_parse_model(const std::string& path, std::string rootbone, VmcModel* model)
+{
+	cgltf_options parse_options = {};
+	parse_options.file.read = &vrm_file_read;
+
+	cgltf_data* data = nullptr;
+	if (cgltf_parse_file(&parse_options, path.c_str(), &data) != cgltf_result_success) {
+		return false;
+	}
+
+	// Constructs humanoid-bone => node mapping 
+	const auto mapping = vrm_get_humanoid_mapping(data);
+	for (std::size_t bone = 0; bone < vrm_humanoid_bone_count; bone++) {
+		if (mapping.bones[bone] != nullptr && mapping.bones[bone]->name != nullptr) {
+			model->bone_names[bone] = mapping.bones[bone]->name;
+		}
+	}
+
+	if (data->vrm_v0_0.humanoid.humanBones_count > 0) {
+		const auto bone = data->vrm_v0_0.humanoid.humanBones[0].bone;
+		if (static_cast<std::size_t>(bone) < vrm_humanoid_bone_count) {
+			model->first_bone = static_cast<uint8_t>(bone);
+		}
+	}
+
+	cgltf_size rootbone_index;
+	model->rootbone_found = vrm_get_root_bone(data, rootbone, &rootbone_index);
+	if (model->rootbone_found) {
+		const auto& rootnode = data->nodes[rootbone_index];
+		model->root_translation = { rootnode.translation[0], rootnode.translation[1], rootnode.translation[2] };
+		model->root_rotation = { rootnode.rotation[0], rootnode.rotation[1], rootnode.rotation[2], rootnode.rotation[3] };
+	}
+
+	cgltf_free(data);
+	return true;
+}
+
+// Humanoid bones of every model parsed in this process, so a model that is
+// announced again, by a new session or another receive shard, isn't parsed
+// again. Entries are keyed by path, size and modification time of the file
+// and the root bone name searched for, a changed file replaces the entry
+// of its path. Given a cache file, entries are read from it on first use
+// and the file is rewritten whenever a model is parsed.
+class VmcModelCache {
+public:
+	static VmcModelCache& instance()
+	{
+		static VmcModelCache cache;
+		return cache;
+	}
+
+	// nullptr when the model file can't be read or parsed. cache_file may
+	// be empty to keep entries in memory only.
+	VmcModel* load(const std::string& path, const std::string& rootbone, const std::string& cache_file)
+	{
+		Key key;
+		key.path = path;
+		key.rootbone = rootbone;
+		if (!vrm_file_stat(path.c_str(), &key.size, &key.mtime)) {
+			return nullptr;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			readFile(cache_file);
+			for (const auto& entry : entries) {
+				if (entry.key == key) {
+					return new VmcModel(entry.model);
 				}
 			}
-			else if (state.received && std::strcmp(address, "/VMC/Ext/Bone/Pos") == 0) {
-
-				const auto name = (arg++)->AsStringUnchecked();
-				const auto px = (arg++)->AsFloatUnchecked();
-				const auto py = (arg++)->AsFloatUnchecked();
-				const auto pz = (arg++)->AsFloatUnchecked();
-				const auto qx = (arg++)->AsFloatUnchecked();
-				const auto qy = (arg++)->AsFloatUnchecked();
-				const auto qz = (arg++)->AsFloatUnchecked();
-				const auto qw = (arg++)->AsFloatUnchecked();
-
-				cgltf_node* node = vrm_get_humanoid_bone(name, &humanoid_mapping);
-
-				if (node != nullptr) {
-					const auto hash  = getStringHash(node->name); // "mixamorig:Hips" etc
-					const auto index = getStringIndex(hash);
-
-					{
-						std::lock_guard<std::mutex> lock(motionclient_lock_guard);
-						transform_data.hashes[index] = hash;
-						transform_data.translations[index] = { px, py, pz };
-						transform_data.rotations[index] = { qx, -qy, -qz, qw };
+		}
+
+		std::unique_ptr<VmcModel> model(new VmcModel);
+		if (!vmc_parse_model(path, rootbone, model.get())) {
+			return nullptr;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		insert(key, *model, true);
+		writeFile(cache_file);
+		return model.release();
+	}
+
+private:
+	// Cache files hold the magic and version, the entry count and the
+	// entries, in native byte order.
+	static const uint32_t file_magic = 0x48434D56; // "VMCH" on little endian hosts
+	static const uint32_t file_version = 1;
+	static const uint32_t max_string_size = 4096;
+
+	struct Key {
+		std::string path;
+		std::string rootbone;
+		uint64_t size;
+		int64_t mtime;
+
+		bool sameModel(const Key& other) const
+		{
+			return path == other.path && rootbone == other.rootbone;
+		}
+
+		bool operator==(const Key& other) const
+		{
+			return sameModel(other) && size == other.size && mtime == other.mtime;
+		}
+	};
+
+	struct Entry {
+		Key key;
+		VmcModel model;
+	};
+
+	VmcModelCache() {}
+
+	void insert(const Key& key, const VmcModel& model, bool replace)
+	{
+		for (auto& entry : entries) {
+			if (entry.key.sameModel(key)) {
+				if (replace) {
+					entry.key = key;
+					entry.model = model;
+				}
+				return;
+			}
+		}
+		entries.push_back(Entry{ key, model });
+	}
+
+	// Merges the entries of a cache file, keeping the ones already in
+	// memory, and writes the file back when it lacks any of them. A
+	// truncated or foreign file contributes what it can.
+	void readFile(const std::string& file)
+	{
+		if (file.empty() || file == read_file) {
+			return;
+		}
+		read_file = file;
+
+		std::vector<Key> file_keys;
+		FILE* f = vrm_file_open(file.c_str());
+		if (f != nullptr) {
+			uint32_t magic, version, count;
+			if (read(f, &magic) && read(f, &version) && read(f, &count) && magic == file_magic && version == file_version) {
+				for (uint32_t i = 0; i < count; i++) {
+					Entry entry;
+					if (!readEntry(f, &entry)) {
+						break;
 					}
+					file_keys.push_back(entry.key);
+					insert(entry.key, entry.model, false);
 				}
 			}
+			fclose(f);
+		}
+
+		for (const auto& entry : entries) {
+			if (std::find(file_keys.begin(), file_keys.end(), entry.key) == file_keys.end()) {
+				writeFile(file);
+				break;
+			}
+		}
+	}
+
+	// Writes a temporary file and renames it over the cache file, so other
+	// processes never read a partial one.
+	void writeFile(const std::string& file) const
+	{
+		if (file.empty()) {
+			return;
+		}
+
+		const auto temporary = file + ".tmp";
+		FILE* f = vrm_file_open(temporary.c_str(), "wb");
+		if (f == nullptr) {
+			return;
+		}
 
-			const auto time = std::chrono::steady_clock::now();
-			const auto delta = std::chrono::duration_cast<std::chrono::milliseconds>(time - lasttime_checked);
-			if (delta > options.interval) {
-				transform_data.availableCount = getAvailableCount(); // This practically enables polling
-				lasttime_checked = time;
+		const uint32_t magic = file_magic, version = file_version;
+		bool written = write(f, magic) && write(f, version) && write(f, static_cast<uint32_t>(entries.size()));
+		for (const auto& entry : entries) {
+			written = written && writeEntry(f, entry);
+		}
+		written = (fclose(f) == 0) && written;
 
+#if defined(_WIN32)
+		if (written) {
+			std::remove(file.c_str());
+		}
+#endif
+		if (!written || std::rename(temporary.c_str(), file.c_str()) != 0) {
+			std::remove(temporary.c_str());
+		}
+	}
+
+	static bool readEntry(FILE* f, Entry* entry)
+	{
+		auto& model = entry->model;
+		uint8_t rootbone_found;
+		if (!readString(f, &entry->key.path) || !readString(f, &entry->key.rootbone)
+			|| !read(f, &entry->key.size) || !read(f, &entry->key.mtime)
+			|| !read(f, &model.first_bone) || !read(f, &rootbone_found)
+			|| !read(f, &model.root_translation) || !read(f, &model.root_rotation)) {
+			return false;
+		}
+		model.rootbone_found = rootbone_found != 0;
+		if (model.first_bone > VmcPoseStore::capacity) {
+			return false;
+		}
+		for (auto& name : model.bone_names) {
+			if (!readString(f, &name)) {
+				return false;
 			}
 		}
-		catch (...) {
+		return true;
+	}
+
+	static bool writeEntry(FILE* f, const Entry& entry)
+	{
+		const auto& model = entry.model;
+		bool written = writeString(f, entry.key.path) && writeString(f, entry.key.rootbone)
+			&& write(f, entry.key.size) && write(f, entry.key.mtime)
+			&& write(f, model.first_bone) && write(f, static_cast<uint8_t>(model.rootbone_found ? 1 : 0))
+			&& write(f, model.root_translation) && write(f, model.root_rotation);
+		for (const auto& name : model.bone_names) {
+			written = written && writeString(f, name);
+		}
+		return written;
+	}
+
+	template <typename T>
+	static bool read(FILE* f, T* value)
+	{
+		return fread(value, sizeof(T), 1, f) == 1;
+	}
+
+	template <typename T>
+	static bool write(FILE* f, const T& value)
+	{
+		return fwrite(&value, sizeof(T), 1, f) == 1;
+	}
+
+	static bool readString(FILE* f, std::string* value)
+	{
+		uint32_t size;
+		if (!read(f, &size) || size > max_string_size) {
+			return false;
+		}
+		value->resize(size);
+		return size == 0 || fread(&(*value)[0], 1, size, f) == size;
+	}
+
+	static bool writeString(FILE* f, const std::string& value)
+	{
+		return write(f, static_cast<uint32_t>(value.size()))
+			&& (value.empty() || fwrite(value.data(), 1, value.size(), f) == value.size());
+	}
+
+	std::mutex mutex;
+	std::vector<Entry> entries;
+	std::string read_file; // cache file whose entries have been merged
+};
+
+// Routes VMC messages by address to the process* handlers below. Other
+// addresses, /VMC/PING among them, have no handler and are ignored.
+class VmcPacketListener : public osc::MessageMappingOscPacketListener<VmcPacketListener> {
+public:
+	VmcPacketListener(std::shared_ptr<VmcPoseStore> store, const vmc_options& options)
+		: store(std::move(store))
+		, root_slot(no_root_slot)
+		, state{ false, false, false }
+		, options(options)
+		, loaded_model(nullptr)
+		, load_finished(false)
+		, pending_written{}
+		, bundle_depth(0)
+		, bundle_wrote_pose(false)
+		, bundle_clock(VmcFrameClock::none)
+		, bundle_sender_time_ns(0)
+	{
+		RegisterMessageFunction("/VMC/Ext/OK", &VmcPacketListener::processAvailable);
+		RegisterMessageFunction("/VMC/Ext/VRM", &VmcPacketListener::processModel);
+		RegisterMessageFunction("/VMC/Ext/Root/Pos", &VmcPacketListener::processRootPose);
+		RegisterMessageFunction("/VMC/Ext/Bone/Pos", &VmcPacketListener::processBonePose);
+		RegisterMessageFunction("/VMC/Ext/T", &VmcPacketListener::processTime);
+		TM_LOG("[INFO] VmcPacketListener created");
+	}
+
+	virtual ~VmcPacketListener()
+	{
+		TM_LOG("[INFO] VmcPacketListener cleaning up");
+		if (loader.joinable()) {
+			loader.join();
+		}
+		delete loaded_model.load(std::memory_order_relaxed);
+		for (const auto hash : added_hashes) {
+			tm_string_repository->remove(tm_string_repository->inst, hash);
+		}
+		TM_LOG("[INFO] VmcPacketListener destroyed");
+	}
+
+	// /VMC/Ext/OK: the sender has loaded and calibrated its model.
+	void processAvailable(const osc::ReceivedMessage& m, const IpEndpointName&)
+	{
+		osc::int32 loaded, calibrated;
+		if (!state.loaded && m.Decode(loaded, calibrated) && loaded == 1 && calibrated == 3) {
+			state.loaded = true;
+		}
+	}
+
+	// /VMC/Ext/VRM: path of the sender's model. Collect bone information,
+	// this should be done only once. Parsing a large model takes tens of
+	// milliseconds, so it runs on a loader thread and takeLoadedModel()
+	// installs the result on this thread once it is ready.
+	void processModel(const osc::ReceivedMessage& m, const IpEndpointName&)
+	{
+		takeLoadedModel();
+
+		const char* value;
+		if (state.received || state.loading || !state.loaded || !m.Decode(value) || strlen(value) == 0) {
+			return;
+		}
+
+		state.loading = true;
+		load_finished.store(false, std::memory_order_relaxed);
+		loader = std::thread(&VmcPacketListener::loadModel, this, std::string(value), options.rootbone, options.model_cache_file);
+	}
+
+	void processRootPose(const osc::ReceivedMessage& m, const IpEndpointName&)
+	{
+		takeLoadedModel();
+
+		const char* name;
+		float px, py, pz, qx, qy, qz, qw;
+		if (!m.Decode(name, px, py, pz, qx, qy, qz, qw)) {
+			return;
+		}
+
+		(void)name; // unused
+
+		if (!state.received) {
+			bufferPose(VmcPoseStore::root_slot, { px, py, pz }, { qx, -qy, -qz, qw });
+			return;
+		}
+		if (root_slot != no_root_slot) {
+			store->writeBone(root_slot, { px, py, pz }, { qx, -qy, -qz, qw });
+		}
+		poseWritten();
+	}
+
+	void processBonePose(const osc::ReceivedMessage& m, const IpEndpointName&)
+	{
+		takeLoadedModel();
+
+		const char* name;
+		float px, py, pz, qx, qy, qz, qw;
+		if (!m.Decode(name, px, py, pz, qx, qy, qz, qw)) {
+			return;
+		}
+
+		cgltf_vrm_humanoid_bone_bone_v0_0 bone;
+		const bool known = vmc_find_humanoid_bone(name, &bone);
+		if (!state.received) {
+			if (known) {
+				bufferPose(static_cast<uint8_t>(bone), { px, py, pz }, { qx, -qy, -qz, qw });
+			}
+			return;
+		}
+		if (known && !model->bone_names[bone].empty()) {
+			store->writeBone(static_cast<uint8_t>(bone), { px, py, pz }, { qx, -qy, -qz, qw });
+		}
+		poseWritten();
+	}
 
+	// /VMC/Ext/T: the sender's time of the frame in its bundle, in seconds.
+	void processTime(const osc::ReceivedMessage& m, const IpEndpointName&)
+	{
+		float seconds;
+		if (bundle_depth > 0 && m.Decode(seconds) && std::isfinite(seconds)) {
+			bundle_clock = VmcFrameClock::vmc_time;
+			bundle_sender_time_ns = static_cast<int64_t>(static_cast<double>(seconds) * 1e9);
 		}
 	}
 
-	uint8_t getAvailableCount() {
-		return static_cast<uint8_t>(hash_map.size());
+	// A VMC sender bundles the bones of a frame, so the pose is published
+	// at the end of every top-level bundle that moved a bone. Poses sent
+	// as lone messages are published at most once per interval instead.
+	void poseWritten()
+	{
+		if (bundle_depth > 0) {
+			bundle_wrote_pose = true;
+		}
+		else {
+			publishIfDue();
+		}
 	}
 
-	uint8_t getStringIndex(uint64_t hash) {
-		const auto iter = hash_to_index_map.find(hash);
-		assert(iter != hash_to_index_map.end());
-		return iter->second;
+	// The frame is placed by its /VMC/Ext/T time if the bundle carries one,
+	// by the time tag of the top-level bundle unless that is immediate.
+	virtual void ProcessBundle(const osc::ReceivedBundle& b, const IpEndpointName& remoteEndpoint) override
+	{
+		if (bundle_depth++ == 0) {
+			bundle_clock = VmcFrameClock::none;
+			if (b.TimeTag() != immediate_time_tag) {
+				bundle_clock = VmcFrameClock::time_tag;
+				bundle_sender_time_ns = timeTagNs(b.TimeTag());
+			}
+		}
+		osc::MessageMappingOscPacketListener<VmcPacketListener>::ProcessBundle(b, remoteEndpoint);
+		if (--bundle_depth == 0 && bundle_wrote_pose) {
+			bundle_wrote_pose = false;
+			const auto time = arrivalTime();
+			store->publish(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count(),
+				bundle_clock, bundle_sender_time_ns);
+			lasttime_checked = time;
+		}
 	}
 
-	uint64_t getStringHash(std::string key) {
-		const auto iter = hash_map.find(key);
-		assert(iter != hash_map.end());
-		return iter->second;
+	// Publishes the pose to motionclient_poll() at most once per interval.
+	void publishIfDue()
+	{
+		const auto time = arrivalTime();
+		const auto delta = std::chrono::duration_cast<std::chrono::milliseconds>(time - lasttime_checked);
+		if (delta > options.interval) {
+			store->publish(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+			lasttime_checked = time;
+		}
 	}
 
-	motion_listener_transform_data_t transform_data;
+	// Malformed packets are dropped without unwinding.
+	virtual void ProcessMalformedPacket(osc::ParseStatus status, MalformedElementKind kind,
+		const char* data, int size, const IpEndpointName& remoteEndpoint) override
+	{
+		(void)status;
+		(void)kind;
+		(void)data;
+		(void)size;
+		(void)remoteEndpoint;
+	}
+
+	// Kernel arrival time of the packet being processed, falling back to the
+	// dispatch time when the socket delivered it without a timestamp.
+	std::chrono::steady_clock::time_point arrivalTime() const {
+		const long long arrival_ns = PacketArrivalTimeNs();
+		if (arrival_ns == 0) {
+			return std::chrono::steady_clock::now();
+		}
+		return std::chrono::steady_clock::time_point(
+			std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(arrival_ns)));
+	}
 
 private:
+	static const uint8_t no_root_slot = VmcPoseStore::capacity; // as VmcModel::first_bone
+	static const osc::uint64 immediate_time_tag = 1;
+
+	// An NTP time tag in nanoseconds since 1900.
+	static int64_t timeTagNs(osc::uint64 time_tag)
+	{
+		const uint64_t seconds = time_tag >> 32;
+		const uint64_t fraction = ((time_tag & 0xFFFFFFFFu) * 1000000000u) >> 32;
+		return static_cast<int64_t>(seconds * 1000000000u + fraction);
+	}
+
+	// Runs on the loader thread.
+	void loadModel(std::string path, std::string rootbone, std::string cache_file)
+	{
+		loaded_model.store(VmcModelCache::instance().load(path, rootbone, cache_file), std::memory_order_relaxed);
+		load_finished.store(true, std::memory_order_release);
+	}
+
+	// Installs the model once the loader thread has parsed it. A model that
+	// fails to parse is retried on the next /VMC/Ext/VRM.
+	void takeLoadedModel()
+	{
+		if (!state.loading || !load_finished.load(std::memory_order_acquire)) {
+			return;
+		}
+		loader.join();
+		state.loading = false;
+
+		std::unique_ptr<VmcModel> loaded(loaded_model.exchange(nullptr, std::memory_order_relaxed));
+		if (loaded) {
+			installModel(std::move(loaded));
+		}
+	}
 
-	cgltf_data* vrmdata;
-	vmc_humanoid_mapping humanoid_mapping;
+	void installModel(std::unique_ptr<VmcModel> loaded)
+	{
+		model = std::move(loaded);
+
+		if (model->rootbone_found) {
+			root_slot = VmcPoseStore::root_slot;
+			store->addBone(root_slot, addHash(options.rootbone.c_str()), model->root_translation, model->root_rotation);
+		}
+		else {
+			// Consider first bone as a root bone when actual root bone is not found
+			root_slot = model->first_bone;
+		}
+
+		for (uint8_t slot = 0; slot < vrm_humanoid_bone_count; slot++) {
+			if (!model->bone_names[slot].empty()) {
+				store->addBone(slot, addHash(model->bone_names[slot].c_str()), { 0, 0, 0 }, { 0, 0, 0, 1 });
+			}
+		}
+
+		// Poses that arrived while the model was loading
+		for (uint8_t slot = 0; slot < vrm_humanoid_bone_count; slot++) {
+			if (pending_written[slot] && !model->bone_names[slot].empty()) {
+				store->writeBone(slot, pending_translations[slot], pending_rotations[slot]);
+			}
+		}
+		if (pending_written[VmcPoseStore::root_slot] && root_slot != no_root_slot) {
+			store->writeBone(root_slot, pending_translations[VmcPoseStore::root_slot], pending_rotations[VmcPoseStore::root_slot]);
+		}
+
+		// published like any other pose, so inside a bundle it is placed on
+		// the bundle's clock rather than by its arrival
+		poseWritten();
+
+		TM_LOG("[INFO] VmcPacketListener starts recording...");
+		state.received = true;
+	}
+
+	// Keeps the newest pose of each bone until the model is installed.
+	void bufferPose(uint8_t slot, const tm_vec3_t& translation, const tm_vec4_t& rotation)
+	{
+		pending_translations[slot] = translation;
+		pending_rotations[slot] = rotation;
+		pending_written[slot] = true;
+	}
+
+	// Registers a node name with the string repository, the listener
+	// releases it again when destroyed.
+	uint64_t addHash(const char* name)
+	{
+		const auto hash = tm_string_repository->add(tm_string_repository->inst, name);
+		added_hashes.push_back(hash);
+		return hash;
+	}
+
+	std::shared_ptr<VmcPoseStore> store; // shared with the pollers until they let go
+	std::unique_ptr<VmcModel> model; // set once the model is installed
+	uint8_t root_slot; // slot root poses go to, no_root_slot without one
 	vmc_state state;
 	vmc_options options;
 	std::chrono::steady_clock::time_point lasttime_checked;
 
-	std::unordered_map<std::string, uint64_t> hash_map;
-	std::unordered_map<uint64_t, uint8_t> hash_to_index_map;
+	std::vector<uint64_t> added_hashes;
+
+	std::thread loader;
+	std::atomic<VmcModel*> loaded_model; // handed over by the loader thread
+	std::atomic<bool> load_finished;
+
+	tm_vec3_t pending_translations[VmcPoseStore::capacity];
+	tm_vec4_t pending_rotations[VmcPoseStore::capacity];
+	bool pending_written[VmcPoseStore::capacity];
+
+	int bundle_depth;
+	bool bundle_wrote_pose;
+	VmcFrameClock::Source bundle_clock; // sender time of the top-level bundle's frame, if any
+	int64_t bundle_sender_time_ns;
+
+};
+
+// motionclient_source_t id of a sender.
+static inline uint64_t vmc_source_id(const IpEndpointName& endpoint)
+{
+	return (static_cast<uint64_t>(endpoint.address & 0xFFFFFFFFUL) << 16) | static_cast<uint64_t>(endpoint.port & 0xFFFF);
+}
+
+// The senders being received, each with its own pose store, in the order
+// their first datagram arrived. Receive shards add and remove sources
+// under writer_lock; readers take an immutable snapshot, swapped whole on
+// every change, so they never wait for a shard.
+class VmcSourceRegistry {
+public:
+	struct Source {
+		IpEndpointName endpoint;
+		std::shared_ptr<VmcPoseStore> store;
+	};
+	typedef std::vector<Source> Sources;
+
+	VmcSourceRegistry()
+		: sources(std::make_shared<Sources>())
+	{
+	}
+
+	void add(const IpEndpointName& endpoint, const std::shared_ptr<VmcPoseStore>& store)
+	{
+		std::lock_guard<std::mutex> lock(writer_lock);
+		std::shared_ptr<Sources> changed = std::make_shared<Sources>(*sources);
+		changed->push_back({ endpoint, store });
+		std::atomic_store(&sources, std::shared_ptr<const Sources>(std::move(changed)));
+	}
 
+	void remove(const IpEndpointName& endpoint)
+	{
+		std::lock_guard<std::mutex> lock(writer_lock);
+		std::shared_ptr<Sources> changed = std::make_shared<Sources>(*sources);
+		changed->erase(std::remove_if(changed->begin(), changed->end(),
+			[&endpoint](const Source& source) { return source.endpoint == endpoint; }), changed->end());
+		std::atomic_store(&sources, std::shared_ptr<const Sources>(std::move(changed)));
+	}
+
+	std::shared_ptr<const Sources> snapshot() const
+	{
+		return std::atomic_load(&sources);
+	}
+
+private:
+	std::mutex writer_lock;
+	std::shared_ptr<const Sources> sources;
+};
+
+// Gives every sender on a shard's socket a listener and pose store of its
+// own, so performers sharing the port are received side by side. Called
+// by the shard's EndpointDemultiplexer on the thread that parses packets.
+class VmcSourceFactory : public EndpointListenerFactory {
+public:
+	VmcSourceFactory(VmcSourceRegistry* registry, const vmc_options& options, osc::BundleScheduler* scheduler)
+		: registry(registry)
+		, options(options)
+		, scheduler(scheduler)
+	{
+	}
+
+	virtual PacketListener* CreateListener(const IpEndpointName& remoteEndpoint) override
+	{
+		std::shared_ptr<VmcPoseStore> store = std::make_shared<VmcPoseStore>(options.extrapolation_ns);
+		std::unique_ptr<VmcPacketListener> listener(new VmcPacketListener(store, options));
+		if (scheduler != nullptr) {
+			listener->SetBundleScheduler(scheduler);
+		}
+		registry->add(remoteEndpoint, store);
+
+		char address[IpEndpointName::ADDRESS_AND_PORT_STRING_LENGTH];
+		remoteEndpoint.AddressAndPortAsString(address);
+		TM_LOG("[INFO] motionclient: receiving from %s", address);
+		return listener.release();
+	}
+
+	virtual void ReleaseListener(const IpEndpointName& remoteEndpoint, PacketListener* listener) override
+	{
+		registry->remove(remoteEndpoint);
+		delete static_cast<VmcPacketListener*>(listener);
+
+		char address[IpEndpointName::ADDRESS_AND_PORT_STRING_LENGTH];
+		remoteEndpoint.AddressAndPortAsString(address);
+		TM_LOG("[INFO] motionclient: stopped receiving from %s", address);
+	}
+
+private:
+	VmcSourceRegistry* registry;
+	vmc_options options;
+	osc::BundleScheduler* scheduler; // nullptr applies bundles on arrival
+};
+
+// One receive socket with its own multiplexer, routing each sender's
+// datagrams to that sender's listener. Several shards bind the same port
+// with SO_REUSEPORT and run on their own threads; the kernel keeps each
+// sender on one shard. With a packet ring the multiplexer only queues
+// datagrams and dispatchQueued() routes them on the polling thread.
+// Scheduled bundles are released, and silent senders let go, on whichever
+// thread parses packets.
+class VmcReceiveShard {
+public:
+	// Largest datagram a ring slot holds. VMC senders keep their bundles
+	// well below this, bigger datagrams are dropped.
+	static const std::size_t packet_ring_slot_size = 4096;
+
+	// How often the receive thread releases scheduled bundles.
+	static const int bundle_release_period_ms = 1;
+
+	// Senders are checked this often and released after source_idle_periods
+	// checks without a datagram, about five seconds of silence.
+	static const int source_release_period_ms = 500;
+	static const int source_idle_periods = 10;
+
+	// Senders a shard receives at once, datagrams of further ones are dropped.
+	static const std::size_t max_sources = 32;
+
+	VmcReceiveShard(VmcSourceRegistry* registry, const vmc_options& options, bool reuse_port)
+		: schedules_bundles(options.schedule_bundles)
+		, source_factory(registry, options, schedules_bundles ? &scheduler : nullptr)
+		, demultiplexer(&source_factory, source_idle_periods, max_sources)
+		, multiplexer(options.receive_backend)
+		, shares_port(reuse_port && socket.SetAllowReusePort(true))
+		, ring(options.packet_ring_slots > 0 ? new PacketRing(options.packet_ring_slots, packet_ring_slot_size) : nullptr)
+		, attached_listener(ring ? static_cast<PacketListener*>(ring.get()) : &demultiplexer)
+		, last_source_release(std::chrono::steady_clock::now())
+	{
+		const bool multicast = options.multicast_group != IpEndpointName::ANY_ADDRESS;
+		if (multicast) {
+			// let other processes on this host listen to the group too
+			socket.SetAllowReuse(true);
+		}
+		socket.Bind(IpEndpointName(IpEndpointName::ANY_ADDRESS, options.port));
+		if (multicast) {
+			socket.JoinMulticastGroup(IpEndpointName(options.multicast_group, options.port));
+		}
+		socket.SetEnableReceiveTimestamps(true);
+		socket.SetEnableDropCounting(true);
+		if (options.receive_buffer_bytes > 0) {
+			const int applied = socket.SetReceiveBufferSize(static_cast<int>(options.receive_buffer_bytes));
+			TM_LOG("[INFO] VmcReceiveShard receive buffer %d bytes", applied);
+		}
+
+		multiplexer.SetReceiveBatchSize(options.receive_batch_size);
+		if (options.receive_drain_budget > 0) {
+			multiplexer.SetDrainUntilEmpty(true, options.receive_drain_budget);
+		}
+		multiplexer.AttachSocketListener(&socket, attached_listener);
+
+		if (!ring) {
+			multiplexer.AttachPeriodicTimerListener(source_release_period_ms, &demultiplexer);
+			if (schedules_bundles) {
+				multiplexer.AttachPeriodicTimerListener(bundle_release_period_ms, &scheduler);
+			}
+		}
+	}
+
+	~VmcReceiveShard()
+	{
+		SocketReceiveStatistics statistics;
+		multiplexer.GetStatistics(statistics);
+		if (statistics.kernelDrops > 0) {
+			TM_LOG("[INFO] VmcReceiveShard: the receive buffer overflowed, %llu datagrams dropped", statistics.kernelDrops);
+		}
+		if (statistics.truncatedDatagrams > 0) {
+			TM_LOG("[INFO] VmcReceiveShard: %llu datagrams too large to receive were dropped", statistics.truncatedDatagrams);
+		}
+		if (ring && ring->DroppedCount() > 0) {
+			TM_LOG("[INFO] VmcReceiveShard: the packet ring overflowed, %llu datagrams dropped", ring->DroppedCount());
+		}
+		if (demultiplexer.RejectedCount() > 0) {
+			TM_LOG("[INFO] VmcReceiveShard: more than %u senders, %llu datagrams dropped",
+				static_cast<unsigned>(max_sources), demultiplexer.RejectedCount());
+		}
+		if (schedules_bundles) {
+			osc::BundleSchedulerStatistics bundles;
+			scheduler.GetStatistics(bundles);
+			TM_LOG("[INFO] VmcReceiveShard: bundles immediate %llu, scheduled %llu, released %llu, late %llu, too far ahead %llu",
+				bundles.immediate, bundles.early, bundles.released, bundles.late, bundles.unscheduled);
+		}
+		if (!ring) {
+			if (schedules_bundles) {
+				multiplexer.DetachPeriodicTimerListener(&scheduler);
+			}
+			multiplexer.DetachPeriodicTimerListener(&demultiplexer);
+		}
+		multiplexer.DetachSocketListener(&socket, attached_listener);
+	}
+
+	void run()
+	{
+		try {
+			multiplexer.Run();
+		}
+		catch (...) {
+			TM_LOG("[ERROR] VmcReceiveShard stopped unexpectedly");
+		}
+	}
+
+	void asynchronousBreak()
+	{
+		multiplexer.AsynchronousBreak();
+	}
+
+	bool sharesPort() const
+	{
+		return shares_port;
+	}
+
+	// Parses the datagrams queued in the packet ring, if there is one,
+	// applies the bundles that have become due and releases silent senders.
+	size_t dispatchQueued()
+	{
+		if (!ring) {
+			return 0;
+		}
+		const auto dispatched = ring->Dispatch(&demultiplexer);
+		if (schedules_bundles) {
+			scheduler.Release();
+		}
+		const auto now = std::chrono::steady_clock::now();
+		if (now - last_source_release >= std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(source_release_period_ms))) {
+			demultiplexer.TimerExpired();
+			last_source_release = now;
+		}
+		return dispatched;
+	}
+
+private:
+	// Declared before the demultiplexer, whose listeners discard their
+	// bundles from the scheduler when it releases them.
+	const bool schedules_bundles;
+	osc::BundleScheduler scheduler;
+	VmcSourceFactory source_factory;
+	EndpointDemultiplexer demultiplexer;
+	UdpSocket socket;
+	SocketReceiveMultiplexer multiplexer;
+	bool shares_port;
+	std::unique_ptr<PacketRing> ring;
+	PacketListener* attached_listener;
+	std::chrono::steady_clock::time_point last_source_release; // with a ring, on the polling thread
+};
+
+// Stores whose poses the poll functions returned last, so a pose stays
+// valid until the next call even if its sender is let go or the client
+// stops meanwhile. Only the polling thread touches them.
+struct VmcHeldStores {
+	struct Source {
+		uint64_t id;
+		std::shared_ptr<VmcPoseStore> store;
+	};
+
+	std::shared_ptr<VmcPoseStore> latest; // of VmcPoseStore::latest()
+	std::shared_ptr<VmcPoseStore> at; // of VmcPoseStore::at()
+	std::vector<Source> sources; // of motionclient_poll_source*()
+};
+
+// Everything a running client owns.
+class VmcClient {
+public:
+	VmcClient(std::int64_t playout_delay_ns, std::int64_t extrapolation_ns)
+		: playout_delay_ns(playout_delay_ns)
+		, polls_at_time(playout_delay_ns > 0 || extrapolation_ns > 0)
+		, idle_store(std::make_shared<VmcPoseStore>(extrapolation_ns))
+	{
+	}
+
+	// motionclient_poll()
+	const motion_listener_transform_data_t* poll(VmcHeldStores& held)
+	{
+		dispatchQueued();
+		if (polls_at_time) {
+			return pollStore(&held.at)->at(motionclient_now_ns() - playout_delay_ns);
+		}
+		return pollStore(&held.latest)->latest();
+	}
+
+	// motionclient_poll_at()
+	const motion_listener_transform_data_t* pollAt(VmcHeldStores& held, int64_t time_ns)
+	{
+		dispatchQueued();
+		return pollStore(&held.at)->at(time_ns);
+	}
+
+	// motionclient_sources(), counting the senders that have published a
+	// frame.
+	uint32_t listSources(VmcHeldStores& held, motionclient_source_t* listed, uint32_t capacity)
+	{
+		dispatchQueued();
+		const auto snapshot = sources.snapshot();
+		// poses of senders that have been let go needn't stay valid past this
+		held.sources.erase(std::remove_if(held.sources.begin(), held.sources.end(),
+			[&snapshot](const VmcHeldStores::Source& kept) {
+				return std::none_of(snapshot->begin(), snapshot->end(),
+					[&kept](const VmcSourceRegistry::Source& source) { return source.store == kept.store; });
+			}), held.sources.end());
+
+		uint32_t count = 0;
+		for (const auto& source : *snapshot) {
+			if (!source.store->hasFrames()) {
+				continue;
+			}
+			if (count < capacity) {
+				listed[count].id = vmc_source_id(source.endpoint);
+				listed[count].address = static_cast<uint32_t>(source.endpoint.address);
+				listed[count].port = static_cast<uint16_t>(source.endpoint.port);
+			}
+			count++;
+		}
+		return count;
+	}
+
+	// motionclient_poll_source()
+	const motion_listener_transform_data_t* pollSource(VmcHeldStores& held, uint64_t id)
+	{
+		dispatchQueued();
+		VmcPoseStore* store = holdSource(held, id);
+		if (store == nullptr) {
+			return nullptr;
+		}
+		if (polls_at_time) {
+			return store->at(motionclient_now_ns() - playout_delay_ns);
+		}
+		return store->latest();
+	}
+
+	// motionclient_poll_source_at()
+	const motion_listener_transform_data_t* pollSourceAt(VmcHeldStores& held, uint64_t id, int64_t time_ns)
+	{
+		dispatchQueued();
+		VmcPoseStore* store = holdSource(held, id);
+		return (store != nullptr) ? store->at(time_ns) : nullptr;
+	}
+
+	// Declared before the shards, which remove their sources when destroyed.
+	VmcSourceRegistry sources;
+	std::vector<std::unique_ptr<VmcReceiveShard>> shards;
+
+private:
+	// Feeds the datagrams the shards queued in their packet rings to the
+	// listeners.
+	void dispatchQueued()
+	{
+		for (auto& shard : shards) {
+			shard->dispatchQueued();
+		}
+	}
+
+	// The store motionclient_poll() reads, kept in held: that of the
+	// earliest sender still received which has published a frame, or an
+	// empty one until there is one.
+	VmcPoseStore* pollStore(std::shared_ptr<VmcPoseStore>* held)
+	{
+		*held = idle_store;
+		const auto snapshot = sources.snapshot();
+		for (const auto& source : *snapshot) {
+			if (source.store->hasFrames()) {
+				*held = source.store;
+				break;
+			}
+		}
+		return held->get();
+	}
+
+	// The store of the sender with the given id, nullptr when it isn't
+	// received or hasn't published a frame. It is held until the next call
+	// for the same id, or the next listSources() once the sender is gone.
+	VmcPoseStore* holdSource(VmcHeldStores& held, uint64_t id)
+	{
+		std::shared_ptr<VmcPoseStore> store;
+		const auto snapshot = sources.snapshot();
+		for (const auto& source : *snapshot) {
+			if (vmc_source_id(source.endpoint) == id && source.store->hasFrames()) {
+				store = source.store;
+				break;
+			}
+		}
+
+		auto kept = std::find_if(held.sources.begin(), held.sources.end(),
+			[id](const VmcHeldStores::Source& source) { return source.id == id; });
+		if (kept == held.sources.end()) {
+			if (store) {
+				held.sources.push_back({ id, store });
+			}
+		}
+		else if (store) {
+			kept->store = store;
+		}
+		else {
+			held.sources.erase(kept);
+		}
+		return store.get();
+	}
+
+	const std::int64_t playout_delay_ns;
+	const bool polls_at_time; // poll() calls VmcPoseStore::at()
+	std::shared_ptr<VmcPoseStore> idle_store; // never written
 };
 
 static std::uint8_t retain_count = 0;
-static VmcPacketListener* packetListener = nullptr;
-static UdpListeningReceiveSocket* receiveSocket = nullptr;
-static std::uint16_t port = 39539;
+// Read and swapped with std::atomic_load() and std::atomic_store() only.
+// The poll functions take their own reference for the call, so the client
+// they use stays alive without a lock shared with the receive threads.
+static std::shared_ptr<VmcClient> client;
+static VmcHeldStores heldStores;
+static const std::uint16_t default_port = 39539;
+
+// Unpublishes the client and deletes it once no poll function uses it any
+// more, so its sockets are closed when motionclient_start_with_options()
+// returns.
+static void motionclient_release(std::shared_ptr<VmcClient> released) {
+	std::atomic_store(&client, std::shared_ptr<VmcClient>());
+	while (released.use_count() > 1) {
+		std::this_thread::yield();
+	}
+}
 
 bool motionclient_started() {
 	return (retain_count > 0);
 }
 
 void motionclient_start(struct tm_string_repository_i* string_repository, struct tm_logger_api* tm_logger_api_) {
+	motionclient_start_with_options(string_repository, tm_logger_api_, nullptr);
+}
+
+void motionclient_start_with_options(struct tm_string_repository_i* string_repository, struct tm_logger_api* tm_logger_api_, const motionclient_options_t* client_options) {
 	if (motionclient_started()) {
 		retain_count++;
 		return;
@@ -241,31 +1511,70 @@ void motionclient_start(struct tm_string_repository_i* string_repository, struct
 	tm_logger_api = tm_logger_api_;
 	tm_string_repository = string_repository;
 
+	std::shared_ptr<VmcClient> created;
 	try {
 		vmc_options options = {};
+		options.port = (client_options != nullptr && client_options->port != 0) ? client_options->port : default_port;
+		options.receive_shards = (client_options != nullptr && client_options->receive_shards > 1) ? client_options->receive_shards : 1;
+		options.receive_backend = (client_options != nullptr && client_options->use_io_uring) ? IO_URING_RECEIVE_BACKEND : WAIT_RECEIVE_BACKEND;
+		options.multicast_group = IpEndpointName::ANY_ADDRESS;
+		if (client_options != nullptr && client_options->multicast_group != nullptr) {
+			const IpEndpointName group(client_options->multicast_group);
+			if (group.IsMulticastAddress()) {
+				options.multicast_group = group.address;
+				options.receive_shards = 1;
+			}
+			else {
+				TM_LOG("[ERROR] motionclient: %s is not a multicast address, receiving unicast only", client_options->multicast_group);
+			}
+		}
 		options.rootbone = "ROOT";
 		options.interval = std::chrono::milliseconds(1000 / 30);
+		options.receive_batch_size = 32; // one VMC frame is ~60 datagrams, drain it in a few wakeups
+		options.receive_drain_budget = 256;
+		options.packet_ring_slots = (client_options != nullptr) ? client_options->packet_ring_slots : 0;
+		options.receive_buffer_bytes = (client_options != nullptr) ? client_options->receive_buffer_bytes : 0;
+		options.schedule_bundles = (client_options != nullptr) && client_options->schedule_bundles;
+		if (client_options != nullptr && client_options->model_cache_file != nullptr) {
+			options.model_cache_file = client_options->model_cache_file;
+		}
+		options.extrapolation_ns = (client_options != nullptr) ? static_cast<std::int64_t>(client_options->extrapolation_ms) * 1000000 : 0;
+		const std::int64_t playout_delay_ns = (client_options != nullptr) ? static_cast<std::int64_t>(client_options->playout_delay_ms) * 1000000 : 0;
 
-		packetListener = new VmcPacketListener(options);
-		receiveSocket = new UdpListeningReceiveSocket(
-			IpEndpointName(IpEndpointName::ANY_ADDRESS, port),
-			packetListener);
+		created.reset(new VmcClient(playout_delay_ns, options.extrapolation_ns));
+		const bool sharded = options.receive_shards > 1;
+		for (std::uint32_t i = 0; i < options.receive_shards; i++) {
+			created->shards.emplace_back(new VmcReceiveShard(&created->sources, options, sharded));
+			if (sharded && !created->shards.back()->sharesPort()) {
+				TM_LOG("[INFO] SO_REUSEPORT is not supported, receiving on a single socket");
+				break;
+			}
+		}
+
+		std::atomic_store(&client, created);
 
 		retain_count = 1;
 
-		receiveSocket->Run();
+		// The first shard runs on the calling thread, the rest get their own.
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < created->shards.size(); i++) {
+			threads.emplace_back(&VmcReceiveShard::run, created->shards[i].get());
+		}
+
+		created->shards[0]->run();
+
+		for (auto& thread : threads) {
+			thread.join();
+		}
 
 		// retain_count should equal zero here because this should happens after vmcclient_stop().
 		assert(retain_count == 0);
 
-		delete receiveSocket;
-		receiveSocket = nullptr;
-
-		delete packetListener;
-		packetListener = nullptr;
+		motionclient_release(std::move(created));
 	}
 	catch (...) {
 		TM_LOG("Failed to start packet listener");
+		motionclient_release(std::move(created));
 		retain_count = 0;
 	}
 }
@@ -277,29 +1586,57 @@ void motionclient_stop() {
 
 	retain_count--;
 
-	if (retain_count == 0 && receiveSocket != nullptr && receiveSocket->IsBound()) {
-		receiveSocket->Break();
+	if (retain_count == 0) {
+		// wakes up every multiplexer even when it is blocked waiting for data
+		const auto current = std::atomic_load(&client);
+		if (current) {
+			for (auto& shard : current->shards) {
+				shard->asynchronousBreak();
+			}
+		}
+	}
+}
 
-		try {
-			// ping listener in order to break the loop when listener is blocking
-			UdpTransmitSocket transmitSocket(IpEndpointName("127.0.0.1", port));
+const motion_listener_transform_data_t* motionclient_poll() {
+	const auto current = std::atomic_load(&client);
+	if (!current) {
+		return nullptr;
+	}
+	return current->poll(heldStores);
+}
 
-			char buffer[64];
-			osc::OutboundPacketStream p(buffer, 64);
-			p << osc::BeginMessage("/VMC/PING") << osc::EndMessage;
+const motion_listener_transform_data_t* motionclient_poll_at(int64_t time_ns) {
+	const auto current = std::atomic_load(&client);
+	if (!current) {
+		return nullptr;
+	}
+	return current->pollAt(heldStores, time_ns);
+}
 
-			transmitSocket.Send(p.Data(), p.Size());
-		}
-		catch (...) {
-			// you can ignore this because listener may be already stopped depending on the break timing
-		}
+uint32_t motionclient_sources(motionclient_source_t* sources, uint32_t capacity) {
+	const auto current = std::atomic_load(&client);
+	if (!current) {
+		return 0;
 	}
+	return current->listSources(heldStores, sources, capacity);
 }
 
-motion_listener_transform_data_t* motionclient_poll() {
-	std::lock_guard<std::mutex> lock(motionclient_lock_guard);
-	if (packetListener == nullptr) {
+const motion_listener_transform_data_t* motionclient_poll_source(uint64_t source) {
+	const auto current = std::atomic_load(&client);
+	if (!current) {
 		return nullptr;
 	}
-	return &packetListener->transform_data;
+	return current->pollSource(heldStores, source);
+}
+
+const motion_listener_transform_data_t* motionclient_poll_source_at(uint64_t source, int64_t time_ns) {
+	const auto current = std::atomic_load(&client);
+	if (!current) {
+		return nullptr;
+	}
+	return current->pollSourceAt(heldStores, source, time_ns);
+}
+
+int64_t motionclient_now_ns() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
\ No newline at end of file
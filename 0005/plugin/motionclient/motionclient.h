@@ -10,16 +10,150 @@ extern "C" {
 
 typedef struct motion_listener_transform_data_t
 {
+	// One slot per VRM humanoid bone in cgltf_vrm_humanoid_bone_bone_v0_0
+	// order followed by the root bone, so a bone keeps its index from pose
+	// to pose. hashes names the model node of each slot, 0 for slots the
+	// model has no node for.
 	uint8_t availableCount;
 	uint64_t* hashes;
 	tm_vec3_t* translations;
 	tm_vec4_t* rotations;
+
+	// Arrival time of the newest datagram in this pose, in nanoseconds on the
+	// std::chrono::steady_clock timeline. Taken by the kernel where the
+	// platform supports receive timestamps, so it excludes dispatch jitter.
+	int64_t arrivalTimeNs;
+
+	// Sequence number of this pose, counting up from 1 with every pose
+	// received from its sender. 0 until the first pose arrives. Interpolated
+	// poses (see playout_delay_ms) count the distinct poses returned.
+	uint64_t frame;
+
+	// How far past the newest received frame this pose was extrapolated,
+	// in nanoseconds, and how many bones it moved (see extrapolation_ms).
+	// 0 for received and interpolated poses.
+	int64_t extrapolatedNs;
+	uint8_t extrapolatedCount;
 } motion_listener_transform_data_t;
 
+// A sender poses are received from, see motionclient_sources().
+typedef struct motionclient_source_t
+{
+	// Selects the sender in motionclient_poll_source(). Made from address
+	// and port, so it stays the same while the sender keeps its socket.
+	uint64_t id;
+	// IPv4 address, in host byte order, and UDP port the sender sends from.
+	uint32_t address;
+	uint16_t port;
+} motionclient_source_t;
+
+typedef struct motionclient_options_t
+{
+	// UDP port to listen on, 0 means the VMC default (39539).
+	uint16_t port;
+
+	// Number of receive sockets bound to the port with SO_REUSEPORT, each
+	// running its own thread. The kernel hashes senders onto sockets, so
+	// several motion sources spread over cores while each source stays in
+	// order. 0 or 1 receives on a single socket, and platforms without
+	// SO_REUSEPORT always use one.
+	uint32_t receive_shards;
+
+	// Receive with io_uring multishot recvmsg instead of epoll. Needs Linux
+	// 6.0 or later, elsewhere the default receive path is used.
+	// Experimental: in the only measurement so far (tools/UdpReceiveBench,
+	// one core VM) it was no faster than epoll and used more CPU per
+	// datagram. Measure on the target machine before enabling it.
+	bool use_io_uring;
+
+	// IPv4 multicast group to join, e.g. "239.255.39.39", so one sender can
+	// feed several render nodes. NULL receives unicast only. Multicast is
+	// received on a single socket whatever receive_shards says, every
+	// socket on the port would otherwise get its own copy of each datagram.
+	const char* multicast_group;
+
+	// 0 parses packets on the receive threads. Otherwise each receive
+	// socket only copies datagrams into a lock-free ring of this many slots
+	// and motionclient_poll() parses whatever is queued on the calling
+	// thread, so no lock is taken per message. Datagrams arriving while a
+	// ring is full are dropped.
+	uint32_t packet_ring_slots;
+
+	// Kernel receive buffer size for each receive socket in bytes, 0 keeps
+	// the system default. Make it deep enough to hold the datagrams that
+	// arrive while the receiver stalls. Datagrams the kernel still drops
+	// are logged when the client stops.
+	uint32_t receive_buffer_bytes;
+
+	// Hold bundles stamped with a future OSC time tag and apply them at
+	// that time, for senders that time-stamp their frames. Time tags are
+	// read against the system clock, so the sender's clock must be in
+	// sync. Bundles more than a second ahead are applied on arrival.
+	bool schedule_bundles;
+
+	// File to keep the humanoid bones of parsed VRM models in, so a model
+	// the process or an earlier run has seen is set up without parsing it
+	// again. Entries are matched on path, size and modification time of
+	// the model file. NULL keeps them in memory for this process only.
+	const char* model_cache_file;
+
+	// Makes motionclient_poll() return the pose from this many milliseconds
+	// ago, interpolated between the frames received around that time, so
+	// network jitter and a sender frame rate unrelated to the game's don't
+	// show as stutter. Make it a little over the sender's frame interval
+	// plus the expected jitter. About a second of frames is kept. Frames
+	// are spaced by the sender's /VMC/Ext/T time, or its bundle time tags,
+	// where it sends them. 0 returns the newest frame as received.
+	uint32_t playout_delay_ms;
+
+	// When frames are late or lost, carry each bone on at its recent
+	// angular and linear velocity for up to this many milliseconds past
+	// the newest frame, slowing down to a stop by then, instead of
+	// freezing. Keeps latency low with little or no playout delay.
+	// motionclient_poll() then returns the pose for the current time even
+	// with playout_delay_ms 0. 0 holds the newest frame.
+	uint32_t extrapolation_ms;
+} motionclient_options_t;
+
 bool motionclient_started();
 void motionclient_start(struct tm_string_repository_i*, struct tm_logger_api*);
+void motionclient_start_with_options(struct tm_string_repository_i*, struct tm_logger_api*, const motionclient_options_t*);
 void motionclient_stop();
-motion_listener_transform_data_t* motionclient_poll();
+// The newest complete pose. It stays valid and unchanged until the next
+// call, which may return a newer pose, even if the client stops
+// meanwhile; call it from one thread only. Compare frame to tell whether a pose is new.
+// Several senders can send to the port, each received on its own; this
+// is the pose of the earliest one still received, see
+// motionclient_poll_source() for the others. A sender silent for about
+// five seconds is let go. NULL when the client isn't running.
+// Polling never waits for a receive thread to parse packets: the client
+// is held through an atomic shared pointer, and the newest pose is handed
+// over in a lock-free triple buffer. The one lock is the sender's frame
+// history, which delayed and extrapolated poses (and motionclient_poll_at())
+// take to copy out the two frames they blend, and which the receive thread
+// takes once per frame to record it.
+const motion_listener_transform_data_t* motionclient_poll();
+// The pose at time_ns on the motionclient_now_ns() timeline, interpolated
+// like with playout_delay_ms whatever the option says: rotations are
+// slerped and translations lerped between the received frames around it.
+// Before the first kept frame that frame is returned, after the last one
+// it is held or extrapolated as extrapolation_ms says.
+// Same rules as motionclient_poll(), but the pose only stays valid until
+// the next motionclient_poll_at() or delayed motionclient_poll().
+const motion_listener_transform_data_t* motionclient_poll_at(int64_t time_ns);
+// Lists the senders poses have been received from, earliest first. Writes
+// up to capacity of them to sources and returns how many there are, 0
+// when the client isn't running. Call it from the thread that polls.
+uint32_t motionclient_sources(motionclient_source_t* sources, uint32_t capacity);
+// motionclient_poll() and motionclient_poll_at() for the sender with the
+// given motionclient_source_t id. A pose stays valid until the next call
+// for the same sender, or the next motionclient_sources() once the sender
+// has been let go. NULL when the sender isn't received (anymore).
+const motion_listener_transform_data_t* motionclient_poll_source(uint64_t source);
+const motion_listener_transform_data_t* motionclient_poll_source_at(uint64_t source, int64_t time_ns);
+// Now in nanoseconds on the std::chrono::steady_clock timeline that
+// arrivalTimeNs and motionclient_poll_at() use.
+int64_t motionclient_now_ns();
 
 #ifdef __cplusplus
 }
@@ -37,42 +37,87 @@
 #ifndef INCLUDED_OSCPACK_MESSAGEMAPPINGOSCPACKETLISTENER_H
 #define INCLUDED_OSCPACK_MESSAGEMAPPINGOSCPACKETLISTENER_H
 
-#include <cstring>
-#include <map>
+#include <vector>
 
 #include "OscPacketListener.h"
+#include "OscAddressPatternMatcher.h"
+#include "OscStr4HashTable.h"
 
 
 
 namespace osc{
 
+// T is the class deriving from MessageMappingOscPacketListener<T>.
+//
+// the registered address patterns are kept in a Str4HashTable, so a
+// received address is routed with one hash over its words and one compare
+// against the single candidate.
+//
+// functions may also be registered for an OSC address pattern such as
+// /VMC/Ext/{Bone,Root}/Pos. all patterns are compiled into a single
+// AddressPatternMatcher, so an address is matched against every pattern
+// in one pass.
 template< class T >
 class MessageMappingOscPacketListener : public OscPacketListener{
 public:
     typedef void (T::*function_type)(const osc::ReceivedMessage&, const IpEndpointName&);
 
+    MessageMappingOscPacketListener() {}
+
 protected:
+    // the first function registered for an address pattern is kept
     void RegisterMessageFunction( const char *addressPattern, function_type f )
     {
-        functions_.insert( std::make_pair( addressPattern, f ) );
+        if( addresses_.Add( addressPattern ) == functions_.size() )
+            functions_.push_back( f );
+    }
+
+    // f is called for every address matching addressPattern, after the
+    // function registered for that exact address if there is one. throws
+    // MalformedAddressPatternException for a malformed pattern.
+    void RegisterMessagePatternFunction( const char *addressPattern, function_type f )
+    {
+        patterns_.AddPattern( addressPattern );
+        patternFunctions_.push_back( f );
+    }
+
+    // calls the function registered for the address of m, then those whose
+    // patterns match it. returns false if there are none.
+    bool DispatchMessage( const osc::ReceivedMessage& m,
+		const IpEndpointName& remoteEndpoint )
+    {
+        bool dispatched = false;
+
+        // integer address patterns (a zero first byte) never match
+        int address = addresses_.Find( m.AddressPattern() );
+        if( address >= 0 ){
+            (static_cast<T*>(this)->*(functions_[ address ]))( m, remoteEndpoint );
+            dispatched = true;
+        }
+
+        if( !patternFunctions_.empty() && !m.AddressPatternIsUInt32() ){
+            const std::vector<std::size_t>& matches = patterns_.Match( m.AddressPattern() );
+            for( std::size_t i = 0; i < matches.size(); ++i ){
+                (static_cast<T*>(this)->*(patternFunctions_[ matches[i] ]))( m, remoteEndpoint );
+                dispatched = true;
+            }
+        }
+
+        return dispatched;
     }
 
     virtual void ProcessMessage( const osc::ReceivedMessage& m,
 		const IpEndpointName& remoteEndpoint )
     {
-        typename function_map_type::iterator i = functions_.find( m.AddressPattern() );
-        if( i != functions_.end() )
-            (dynamic_cast<T*>(this)->*(i->second))( m, remoteEndpoint );
+        DispatchMessage( m, remoteEndpoint );
     }
     
 private:
-    struct cstr_compare{
-        bool operator()( const char *lhs, const char *rhs ) const
-            { return std::strcmp( lhs, rhs ) < 0; }
-    };
+    Str4HashTable addresses_;
+    std::vector<function_type> functions_; // indexed by address
 
-    typedef std::map<const char*, function_type, cstr_compare> function_map_type;
-    function_map_type functions_;
+    AddressPatternMatcher patterns_;
+    std::vector<function_type> patternFunctions_; // indexed by pattern
 };
 
 } // namespace osc
@@ -0,0 +1,332 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "OscAddressPatternMatcher.h"
+
+#include <algorithm>
+#include <map>
+
+
+namespace osc{
+
+namespace{
+
+// the characters ?, * and [!...] may match: anything within one part of
+// an address
+std::bitset<256> PartCharacters()
+{
+    std::bitset<256> result;
+    result.set();
+    result.reset( (unsigned char)'/' );
+    result.reset( 0 );
+    return result;
+}
+
+std::bitset<256> SingleCharacter( char c )
+{
+    std::bitset<256> result;
+    result.set( (unsigned char)c );
+    return result;
+}
+
+} // anonymous namespace
+
+
+AddressPatternMatcher::AddressPatternMatcher()
+    : nfa_( 1 )
+    , patternCount_( 0 )
+    , classCount_( 0 )
+{
+    std::fill( characterClass_, characterClass_ + 256, (unsigned char)0 );
+}
+
+
+int AddressPatternMatcher::AddNfaState()
+{
+    nfa_.push_back( NfaState() );
+    return (int)nfa_.size() - 1;
+}
+
+
+void AddressPatternMatcher::AddNfaEdge( int from, const CharacterSet& characters, int to )
+{
+    NfaEdge edge;
+    edge.characters = characters;
+    edge.target = to;
+    nfa_[from].edges.push_back( edge );
+}
+
+
+std::size_t AddressPatternMatcher::AddPattern( const char *pattern )
+{
+    const std::size_t index = patternCount_;
+    const std::size_t nfaSize = nfa_.size();
+
+    int current = AddNfaState();
+    nfa_[0].epsilons.push_back( current );
+
+    try{
+        const char *p = pattern;
+        while( *p != '\0' ){
+            switch( *p ){
+                case '?':
+                    {
+                        int next = AddNfaState();
+                        AddNfaEdge( current, PartCharacters(), next );
+                        current = next;
+                        ++p;
+                    }
+                    break;
+
+                case '*':
+                    {
+                        int next = AddNfaState();
+                        nfa_[current].epsilons.push_back( next );
+                        AddNfaEdge( next, PartCharacters(), next );
+                        current = next;
+                        ++p;
+                    }
+                    break;
+
+                case '[':
+                    {
+                        ++p;
+                        bool negated = false;
+                        if( *p == '!' ){
+                            negated = true;
+                            ++p;
+                        }
+
+                        // a ']' first in the list is taken literally, as is
+                        // a '-' first or last
+                        CharacterSet characters;
+                        bool first = true;
+                        while( *p != ']' || first ){
+                            if( *p == '\0' )
+                                throw MalformedAddressPatternException( "unterminated [ in address pattern" );
+
+                            unsigned char low = (unsigned char)*p;
+                            if( p[1] == '-' && p[2] != ']' && p[2] != '\0' ){
+                                unsigned char high = (unsigned char)p[2];
+                                if( high < low )
+                                    std::swap( low, high );
+                                for( unsigned int c = low; c <= high; ++c )
+                                    characters.set( c );
+                                p += 3;
+                            }else{
+                                characters.set( low );
+                                ++p;
+                            }
+                            first = false;
+                        }
+                        ++p;
+
+                        if( negated )
+                            characters = ~characters & PartCharacters();
+
+                        int next = AddNfaState();
+                        AddNfaEdge( current, characters, next );
+                        current = next;
+                    }
+                    break;
+
+                case '{':
+                    {
+                        ++p;
+                        int next = AddNfaState();
+                        for(;;){
+                            // each alternative is a string of literal characters
+                            int from = current;
+                            while( *p != ',' && *p != '}' ){
+                                if( *p == '\0' )
+                                    throw MalformedAddressPatternException( "unterminated { in address pattern" );
+                                if( *p == '{' )
+                                    throw MalformedAddressPatternException( "nested { in address pattern" );
+
+                                int to = AddNfaState();
+                                AddNfaEdge( from, SingleCharacter( *p ), to );
+                                from = to;
+                                ++p;
+                            }
+                            nfa_[from].epsilons.push_back( next );
+
+                            if( *p++ == '}' )
+                                break;
+                        }
+                        current = next;
+                    }
+                    break;
+
+                default:
+                    {
+                        int next = AddNfaState();
+                        AddNfaEdge( current, SingleCharacter( *p ), next );
+                        current = next;
+                        ++p;
+                    }
+            }
+        }
+    }catch( ... ){
+        nfa_.resize( nfaSize );
+        nfa_[0].epsilons.pop_back();
+        throw;
+    }
+
+    nfa_[current].acceptedPatterns.push_back( index );
+    ++patternCount_;
+
+    Compile();
+
+    return index;
+}
+
+
+void AddressPatternMatcher::EpsilonClosure( std::vector<int>& states ) const
+{
+    std::vector<bool> reached( nfa_.size(), false );
+    std::vector<int> pending( states );
+    states.clear();
+
+    while( !pending.empty() ){
+        int state = pending.back();
+        pending.pop_back();
+        if( reached[state] )
+            continue;
+
+        reached[state] = true;
+        states.push_back( state );
+        pending.insert( pending.end(), nfa_[state].epsilons.begin(), nfa_[state].epsilons.end() );
+    }
+
+    std::sort( states.begin(), states.end() );
+}
+
+
+void AddressPatternMatcher::Compile()
+{
+    // split the characters into classes so that every edge's character
+    // set is a union of whole classes
+    std::fill( characterClass_, characterClass_ + 256, (unsigned char)0 );
+    classCount_ = 1;
+    for( std::size_t i = 0; i < nfa_.size(); ++i ){
+        for( std::size_t j = 0; j < nfa_[i].edges.size(); ++j ){
+            const CharacterSet& characters = nfa_[i].edges[j].characters;
+
+            int refined[512];
+            std::fill( refined, refined + 512, -1 );
+            std::size_t refinedCount = 0;
+            for( int c = 0; c < 256; ++c ){
+                int key = characterClass_[c] * 2 + (characters.test( c ) ? 1 : 0);
+                if( refined[key] < 0 )
+                    refined[key] = (int)refinedCount++;
+                characterClass_[c] = (unsigned char)refined[key];
+            }
+            classCount_ = refinedCount;
+        }
+    }
+
+    unsigned char representative[256];
+    for( int c = 255; c >= 0; --c )
+        representative[ characterClass_[c] ] = (unsigned char)c;
+
+    // subset construction, dfa state 0 is the closure of the nfa start state
+    std::map< std::vector<int>, int > dfaStates;
+    std::vector< std::vector<int> > pending;
+
+    std::vector<int> start( 1, 0 );
+    EpsilonClosure( start );
+    dfaStates[ start ] = 0;
+    pending.push_back( start );
+
+    transitions_.assign( classCount_, -1 );
+    acceptedPatterns_.assign( 1, std::vector<std::size_t>() );
+
+    for( std::size_t state = 0; state < pending.size(); ++state ){
+        const std::vector<int> nfaStates = pending[state];
+
+        std::vector<std::size_t>& accepted = acceptedPatterns_[state];
+        for( std::size_t i = 0; i < nfaStates.size(); ++i ){
+            const std::vector<std::size_t>& patterns = nfa_[ nfaStates[i] ].acceptedPatterns;
+            accepted.insert( accepted.end(), patterns.begin(), patterns.end() );
+        }
+        std::sort( accepted.begin(), accepted.end() );
+        accepted.erase( std::unique( accepted.begin(), accepted.end() ), accepted.end() );
+
+        for( std::size_t characterClass = 0; characterClass < classCount_; ++characterClass ){
+            const unsigned char c = representative[ characterClass ];
+
+            std::vector<int> next;
+            for( std::size_t i = 0; i < nfaStates.size(); ++i ){
+                const std::vector<NfaEdge>& edges = nfa_[ nfaStates[i] ].edges;
+                for( std::size_t j = 0; j < edges.size(); ++j ){
+                    if( edges[j].characters.test( c ) )
+                        next.push_back( edges[j].target );
+                }
+            }
+            if( next.empty() )
+                continue;
+
+            EpsilonClosure( next );
+
+            std::map< std::vector<int>, int >::iterator i = dfaStates.find( next );
+            if( i == dfaStates.end() ){
+                i = dfaStates.insert( std::make_pair( next, (int)pending.size() ) ).first;
+                pending.push_back( next );
+                transitions_.resize( transitions_.size() + classCount_, -1 );
+                acceptedPatterns_.push_back( std::vector<std::size_t>() );
+            }
+            transitions_[ state * classCount_ + characterClass ] = i->second;
+        }
+    }
+}
+
+
+const std::vector<std::size_t>& AddressPatternMatcher::Match( const char *address ) const
+{
+    if( patternCount_ == 0 )
+        return noPatterns_;
+
+    int state = 0;
+    for( const unsigned char *p = (const unsigned char*)address; *p != '\0'; ++p ){
+        state = transitions_[ state * classCount_ + characterClass_[*p] ];
+        if( state < 0 )
+            return noPatterns_;
+    }
+
+    return acceptedPatterns_[ state ];
+}
+
+} // namespace osc
@@ -0,0 +1,121 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCADDRESSPATTERNMATCHER_H
+#define INCLUDED_OSCPACK_OSCADDRESSPATTERNMATCHER_H
+
+#include <bitset>
+#include <cstddef> // size_t
+#include <vector>
+
+#include "OscException.h"
+
+
+namespace osc{
+
+class MalformedAddressPatternException : public Exception{
+public:
+    MalformedAddressPatternException( const char *w="malformed address pattern" )
+        : Exception( w ) {}
+};
+
+
+/*
+    AddressPatternMatcher compiles a set of OSC address patterns into one
+    deterministic automaton, so an address is matched against all of them
+    in a single pass over its characters.
+
+    Patterns use the OSC 1.0 syntax:
+
+        ?           any single character other than '/'
+        *           any sequence of zero or more characters other than '/'
+        [abc]       any of the listed characters, ranges as in [a-z]
+        [!abc]      any character other than '/' not listed
+        {foo,bar}   any of the comma separated strings
+
+    any other character matches itself. the automaton is rebuilt by each
+    AddPattern() call, so patterns are best added up front.
+*/
+class AddressPatternMatcher{
+public:
+    AddressPatternMatcher();
+
+    // returns the index of the pattern, patterns are numbered from zero in
+    // the order they are added. throws MalformedAddressPatternException
+    // for an unterminated [ or { or a nested {.
+    std::size_t AddPattern( const char *pattern );
+
+    std::size_t PatternCount() const { return patternCount_; }
+
+    // the indices of all patterns matching the whole of address, in
+    // ascending order. the result is empty when nothing matches.
+    const std::vector<std::size_t>& Match( const char *address ) const;
+
+private:
+    typedef std::bitset<256> CharacterSet;
+
+    struct NfaEdge{
+        CharacterSet characters;
+        int target;
+    };
+
+    struct NfaState{
+        std::vector<NfaEdge> edges;
+        std::vector<int> epsilons;
+        std::vector<std::size_t> acceptedPatterns;
+    };
+
+    int AddNfaState();
+    void AddNfaEdge( int from, const CharacterSet& characters, int to );
+    void Compile();
+    void EpsilonClosure( std::vector<int>& states ) const;
+
+    std::vector<NfaState> nfa_; // nfa_[0] is the start state
+    std::size_t patternCount_;
+
+    // the dfa works on classes of characters which no pattern tells apart.
+    // transitions_[ state * classCount_ + class ] is the next state, or -1
+    // once no pattern can match any more.
+    unsigned char characterClass_[256];
+    std::size_t classCount_;
+    std::vector<int> transitions_;
+    std::vector< std::vector<std::size_t> > acceptedPatterns_;
+    const std::vector<std::size_t> noPatterns_;
+};
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCPACK_OSCADDRESSPATTERNMATCHER_H */
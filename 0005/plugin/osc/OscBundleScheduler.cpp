@@ -0,0 +1,183 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "OscBundleScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "OscPacketListener.h"
+#include "OscReceivedElements.h"
+
+
+namespace osc{
+
+namespace{
+
+// seconds from the NTP epoch (1900) to the unix epoch (1970)
+const uint64 NTP_UNIX_EPOCH_OFFSET_SECONDS = 2208988800ULL;
+
+// OSC time tag meaning "immediately"
+const uint64 IMMEDIATE_TIME_TAG = 1;
+
+uint64 MillisecondsToTimeTag( int milliseconds )
+{
+    return ((uint64)milliseconds << 32) / 1000;
+}
+
+} // anonymous namespace
+
+
+BundleScheduler::BundleScheduler( std::size_t capacity, int maxScheduleAheadMilliseconds )
+    : capacity_( capacity )
+    , maxScheduleAhead_( MillisecondsToTimeTag( maxScheduleAheadMilliseconds ) )
+    , sequence_( 0 )
+{
+    statistics_.immediate = 0;
+    statistics_.late = 0;
+    statistics_.early = 0;
+    statistics_.unscheduled = 0;
+    statistics_.released = 0;
+}
+
+
+uint64 BundleScheduler::CurrentTimeTag()
+{
+    const long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+    const uint64 seconds = (uint64)(ns / 1000000000LL) + NTP_UNIX_EPOCH_OFFSET_SECONDS;
+    const uint64 fraction = ((uint64)(ns % 1000000000LL) << 32) / 1000000000ULL;
+    return (seconds << 32) | fraction;
+}
+
+
+bool BundleScheduler::Schedule( OscPacketListener *listener, const ReceivedBundle& bundle,
+        const IpEndpointName& remoteEndpoint, long long arrivalTimeNs )
+{
+    const uint64 timeTag = bundle.TimeTag();
+    if( timeTag == IMMEDIATE_TIME_TAG ){
+        ++statistics_.immediate;
+        return false;
+    }
+
+    const uint64 now = CurrentTimeTag();
+    if( timeTag <= now ){
+        ++statistics_.late;
+        return false;
+    }
+
+    if( queue_.size() >= capacity_ || timeTag - now > maxScheduleAhead_ ){
+        ++statistics_.unscheduled;
+        return false;
+    }
+
+    ScheduledBundle scheduled;
+    scheduled.timeTag = timeTag;
+    scheduled.sequence = sequence_++;
+    scheduled.listener = listener;
+    scheduled.remoteEndpoint = remoteEndpoint;
+    scheduled.arrivalTimeNs = arrivalTimeNs;
+    if( !spareBuffers_.empty() ){
+        scheduled.data.swap( spareBuffers_.back() );
+        spareBuffers_.pop_back();
+    }
+    scheduled.data.assign( bundle.Contents(), bundle.Contents() + bundle.Size() );
+
+    queue_.push_back( std::move( scheduled ) );
+    std::push_heap( queue_.begin(), queue_.end(), Later() );
+
+    ++statistics_.early;
+    return true;
+}
+
+
+std::size_t BundleScheduler::Release()
+{
+    std::size_t released = 0;
+    if( queue_.empty() )
+        return released;
+
+    const uint64 now = CurrentTimeTag();
+    while( !queue_.empty() && queue_.front().timeTag <= now ){
+        std::pop_heap( queue_.begin(), queue_.end(), Later() );
+        ScheduledBundle scheduled( std::move( queue_.back() ) );
+        queue_.pop_back();
+
+        ++statistics_.released;
+        ++released;
+
+        // the bundle was validated when it was queued
+        ReceivedPacket packet;
+        ReceivedBundle bundle;
+        if( ReceivedPacket::Parse( &scheduled.data[0], scheduled.data.size(), packet ) == PARSE_OK
+                && ReceivedBundle::Parse( packet, bundle ) == PARSE_OK ){
+            scheduled.listener->ProcessScheduledBundle(
+                    bundle, scheduled.remoteEndpoint, scheduled.arrivalTimeNs );
+        }
+
+        spareBuffers_.push_back( std::vector<char>() );
+        spareBuffers_.back().swap( scheduled.data );
+    }
+
+    return released;
+}
+
+
+void BundleScheduler::TimerExpired()
+{
+    Release();
+}
+
+
+void BundleScheduler::Discard( const OscPacketListener *listener )
+{
+    std::size_t kept = 0;
+    for( std::size_t i = 0; i < queue_.size(); ++i ){
+        if( queue_[i].listener != listener ){
+            if( kept != i )
+                queue_[kept] = std::move( queue_[i] );
+            ++kept;
+        }
+    }
+
+    if( kept != queue_.size() ){
+        queue_.erase( queue_.begin() + kept, queue_.end() );
+        std::make_heap( queue_.begin(), queue_.end(), Later() );
+    }
+}
+
+} // namespace osc
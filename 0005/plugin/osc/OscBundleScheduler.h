@@ -0,0 +1,150 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCBUNDLESCHEDULER_H
+#define INCLUDED_OSCPACK_OSCBUNDLESCHEDULER_H
+
+#include <cstddef> // size_t
+#include <vector>
+
+#include "OscTypes.h"
+#include "../ip/IpEndpointName.h"
+#include "../ip/TimerListener.h"
+
+
+namespace osc{
+
+class OscPacketListener;
+class ReceivedBundle;
+
+
+struct BundleSchedulerStatistics{
+    // bundles with the immediate time tag, dispatched on arrival
+    unsigned long long immediate;
+
+    // bundles whose time tag had passed when they arrived, dispatched on arrival
+    unsigned long long late;
+
+    // bundles with a future time tag, queued until it came
+    unsigned long long early;
+
+    // bundles with a future time tag dispatched on arrival, because the
+    // queue was full or the time tag was further ahead than the limit
+    unsigned long long unscheduled;
+
+    // bundles released from the queue
+    unsigned long long released;
+};
+
+
+/*
+    BundleScheduler holds received bundles whose time tag lies in the future
+    and hands them back to their OscPacketListener once that time has come.
+    Install it with OscPacketListener::SetBundleScheduler() and call
+    Release() regularly on the thread that processes packets, usually by
+    attaching the scheduler to the same SocketReceiveMultiplexer as a
+    periodic timer listener.
+
+    Time tags are compared against the system clock as NTP time, so the
+    sender's clock is assumed to be synchronised with ours. Bundles are
+    copied when queued; nested bundles are dispatched with the bundle
+    which contains them.
+*/
+class BundleScheduler : public TimerListener{
+public:
+    enum { DEFAULT_CAPACITY = 1024 };
+    enum { DEFAULT_MAX_SCHEDULE_AHEAD_MILLISECONDS = 1000 };
+
+    BundleScheduler( std::size_t capacity=DEFAULT_CAPACITY,
+            int maxScheduleAheadMilliseconds=DEFAULT_MAX_SCHEDULE_AHEAD_MILLISECONDS );
+
+    // the current time as an OSC (NTP) time tag
+    static uint64 CurrentTimeTag();
+
+    // dispatches every queued bundle whose time has come, in time tag
+    // order. returns the number of bundles dispatched.
+    std::size_t Release();
+
+    virtual void TimerExpired();
+
+    // drops the bundles queued for listener without dispatching them
+    void Discard( const OscPacketListener *listener );
+
+    std::size_t QueuedCount() const { return queue_.size(); }
+
+    void GetStatistics( BundleSchedulerStatistics& statistics ) const { statistics = statistics_; }
+
+private:
+    BundleScheduler( const BundleScheduler& ); // no copying
+    BundleScheduler& operator=( const BundleScheduler& );
+
+    friend class OscPacketListener;
+
+    // queues bundle if its time tag is in the future. returns false if
+    // the listener should dispatch it now.
+    bool Schedule( OscPacketListener *listener, const ReceivedBundle& bundle,
+            const IpEndpointName& remoteEndpoint, long long arrivalTimeNs );
+
+    struct ScheduledBundle{
+        uint64 timeTag;
+        unsigned long long sequence; // keeps bundles with equal time tags in arrival order
+        OscPacketListener *listener;
+        IpEndpointName remoteEndpoint;
+        long long arrivalTimeNs;
+        std::vector<char> data;
+    };
+
+    // orders the heap so the earliest bundle is at the front
+    struct Later{
+        bool operator()( const ScheduledBundle& lhs, const ScheduledBundle& rhs ) const
+        {
+            return lhs.timeTag > rhs.timeTag
+                    || ( lhs.timeTag == rhs.timeTag && lhs.sequence > rhs.sequence );
+        }
+    };
+
+    const std::size_t capacity_;
+    const uint64 maxScheduleAhead_; // in time tag units
+
+    std::vector<ScheduledBundle> queue_; // a heap ordered by Later
+    std::vector< std::vector<char> > spareBuffers_;
+    unsigned long long sequence_;
+    BundleSchedulerStatistics statistics_;
+};
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCPACK_OSCBUNDLESCHEDULER_H */
@@ -48,6 +48,7 @@
 #include <cstddef> // ptrdiff_t
 
 #include "OscHostEndianness.h"
+#include "OscReceivedElements.h"
 
 #if defined(__BORLANDC__) // workaround for BCB4 release build intrinsics bug
 namespace std {
@@ -121,6 +122,26 @@ static void FromInt64( char *p, int64 x )
 }
 
 
+static void FromFloat( char *p, float x )
+{
+#ifdef OSC_HOST_LITTLE_ENDIAN
+    union{
+        float f;
+        char c[4];
+    } u;
+
+    u.f = x;
+
+    p[3] = u.c[0];
+    p[2] = u.c[1];
+    p[1] = u.c[2];
+    p[0] = u.c[3];
+#else
+    *reinterpret_cast<float*>(p) = x;
+#endif
+}
+
+
 static void FromUInt64( char *p, uint64 x )
 {
 #ifdef OSC_HOST_LITTLE_ENDIAN
@@ -152,6 +173,166 @@ static inline std::size_t RoundUp4( std::size_t x )
 }
 
 
+// the first 4 byte boundary after the end of the str4 at p, found the way
+// ReceivedMessage finds it
+static std::size_t Str4Size( const char *p )
+{
+    const char *end = p + 3;
+    while( *end )
+        end += 4;
+
+    return (end + 1) - p;
+}
+
+
+MessageTemplate::MessageTemplate( const char *data, std::size_t size )
+{
+    Init( data, size );
+}
+
+
+MessageTemplate::MessageTemplate( const OutboundPacketStream& message )
+{
+    if( !message.IsReady() )
+        throw MessageInProgressException();
+
+    Init( message.Data(), message.Size() );
+}
+
+
+void MessageTemplate::Init( const char *data, std::size_t size )
+{
+    ReceivedPacket packet( data, size );
+    if( packet.IsBundle() )
+        throw MalformedMessageException( "message template holds a bundle" );
+
+    ReceivedMessage message( packet );
+
+    data_.assign( data, data + size );
+    typeTagsOffset_ = 0;
+    argumentOffsets_.clear();
+
+    const char *typeTags = message.TypeTags();
+    if( typeTags == 0 )
+        return;
+
+    typeTagsOffset_ = typeTags - data;
+
+    // the type tag string starts with the comma in front of typeTags
+    const char *argument = typeTags - 1 + Str4Size( typeTags - 1 );
+    for( const char *typeTag = typeTags; *typeTag != '\0'; ++typeTag ){
+        argumentOffsets_.push_back( argument - data );
+
+        switch( *typeTag ){
+            case INT32_TYPE_TAG:
+            case FLOAT_TYPE_TAG:
+            case CHAR_TYPE_TAG:
+            case RGBA_COLOR_TYPE_TAG:
+            case MIDI_MESSAGE_TYPE_TAG:
+                argument += 4;
+                break;
+
+            case INT64_TYPE_TAG:
+            case TIME_TAG_TYPE_TAG:
+            case DOUBLE_TYPE_TAG:
+                argument += 8;
+                break;
+
+            case STRING_TYPE_TAG:
+            case SYMBOL_TYPE_TAG:
+                argument += Str4Size( argument );
+                break;
+
+            case BLOB_TYPE_TAG:
+                {
+                    uint32 blobSize = (uint32)(((unsigned char)argument[0] << 24)
+                            | ((unsigned char)argument[1] << 16)
+                            | ((unsigned char)argument[2] << 8)
+                            | (unsigned char)argument[3]);
+                    argument += 4 + RoundUp4( blobSize );
+                }
+                break;
+
+            default: // T F N I [ ] carry no data
+                break;
+        }
+    }
+}
+
+
+char *MessageTemplate::Argument( std::size_t index, char typeTag )
+{
+    if( index >= argumentOffsets_.size() )
+        throw MissingArgumentException();
+
+    if( data_[ typeTagsOffset_ + index ] != typeTag )
+        throw WrongArgumentTypeException();
+
+    return &data_[ argumentOffsets_[ index ] ];
+}
+
+
+void MessageTemplate::SetInt32( std::size_t index, int32 value )
+{
+    FromInt32( Argument( index, INT32_TYPE_TAG ), value );
+}
+
+
+void MessageTemplate::SetFloat( std::size_t index, float value )
+{
+    FromFloat( Argument( index, FLOAT_TYPE_TAG ), value );
+}
+
+
+void MessageTemplate::SetInt64( std::size_t index, int64 value )
+{
+    FromInt64( Argument( index, INT64_TYPE_TAG ), value );
+}
+
+
+void MessageTemplate::SetDouble( std::size_t index, double value )
+{
+#ifdef OSC_HOST_LITTLE_ENDIAN
+    union{
+        double d;
+        uint64 i;
+    } u;
+
+    u.d = value;
+
+    FromUInt64( Argument( index, DOUBLE_TYPE_TAG ), u.i );
+#else
+    std::memcpy( Argument( index, DOUBLE_TYPE_TAG ), &value, 8 );
+#endif
+}
+
+
+void MessageTemplate::SetTimeTag( std::size_t index, const TimeTag& value )
+{
+    FromUInt64( Argument( index, TIME_TAG_TYPE_TAG ), value.value );
+}
+
+
+void MessageTemplate::SetFloats( std::size_t index, const float *values, std::size_t count )
+{
+    if( count == 0 )
+        return;
+
+    // floats are consecutive 4 byte arguments, so after checking the type
+    // tags the values are stored one after another
+    char *p = Argument( index, FLOAT_TYPE_TAG );
+    if( index + count > argumentOffsets_.size() )
+        throw MissingArgumentException();
+    for( std::size_t i = 1; i < count; ++i ){
+        if( data_[ typeTagsOffset_ + index + i ] != FLOAT_TYPE_TAG )
+            throw WrongArgumentTypeException();
+    }
+
+    for( std::size_t i = 0; i < count; ++i, p += 4 )
+        FromFloat( p, values[i] );
+}
+
+
 OutboundPacketStream::OutboundPacketStream( char *buffer, std::size_t capacity )
     : data_( buffer )
     , end_( data_ + capacity )
@@ -678,6 +859,28 @@ OutboundPacketStream& OutboundPacketStream::operator<<( const ArrayTerminator& r
     return *this;
 }
 
+
+OutboundPacketStream& OutboundPacketStream::operator<<( const MessageTemplate& rhs )
+{
+    if( IsMessageInProgress() )
+        throw MessageInProgressException();
+
+    std::size_t required = Size() + ((ElementSizeSlotRequired())?4:0) + rhs.Size();
+    if( required > Capacity() )
+        throw OutOfBufferMemoryException();
+
+    messageCursor_ = BeginElement( messageCursor_ );
+
+    std::memcpy( messageCursor_, rhs.Data(), rhs.Size() );
+    messageCursor_ += rhs.Size();
+
+    argumentCurrent_ = messageCursor_;
+
+    EndElement( messageCursor_ );
+
+    return *this;
+}
+
 } // namespace osc
 
 
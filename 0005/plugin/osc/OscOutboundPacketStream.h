@@ -38,6 +38,7 @@
 #define INCLUDED_OSCPACK_OSCOUTBOUNDPACKETSTREAM_H
 
 #include <cstring> // size_t
+#include <vector>
 
 #include "OscTypes.h"
 #include "OscException.h"
@@ -73,6 +74,55 @@ public:
 };
 
 
+class OutboundPacketStream;
+
+
+/*
+    MessageTemplate holds an encoded message whose layout doesn't change,
+    so it can be sent again and again with new argument values without
+    being encoded again. Build the message once with an OutboundPacketStream,
+    using placeholder values for the arguments that vary, then patch them
+    in place with the Set functions and append the template to a stream
+    with operator<<, or send Data() as it is.
+
+    Only fixed size arguments can be set. Strings, symbols and blobs keep
+    the values the template was built with. Arguments are indexed as in
+    the type tag string. The Set functions throw WrongArgumentTypeException
+    if the argument has a different type, and MissingArgumentException if
+    the index is past the last argument.
+*/
+class MessageTemplate{
+public:
+    // data must hold a single message, such as an OutboundPacketStream
+    // that holds one message. throws MalformedPacketException or
+    // MalformedMessageException if it doesn't.
+    MessageTemplate( const char *data, std::size_t size );
+    explicit MessageTemplate( const OutboundPacketStream& message );
+
+    std::size_t ArgumentCount() const { return argumentOffsets_.size(); }
+
+    void SetInt32( std::size_t index, int32 value );
+    void SetFloat( std::size_t index, float value );
+    void SetInt64( std::size_t index, int64 value );
+    void SetDouble( std::size_t index, double value );
+    void SetTimeTag( std::size_t index, const TimeTag& value );
+
+    // sets the count float arguments starting at index
+    void SetFloats( std::size_t index, const float *values, std::size_t count );
+
+    const char *Data() const { return &data_[0]; }
+    std::size_t Size() const { return data_.size(); }
+
+private:
+    void Init( const char *data, std::size_t size );
+    char *Argument( std::size_t index, char typeTag );
+
+    std::vector<char> data_;
+    std::size_t typeTagsOffset_;
+    std::vector<std::size_t> argumentOffsets_;
+};
+
+
 class OutboundPacketStream{
 public:
 	OutboundPacketStream( char *buffer, std::size_t capacity );
@@ -124,6 +174,10 @@ public:
     OutboundPacketStream& operator<<( const ArrayInitiator& rhs );
     OutboundPacketStream& operator<<( const ArrayTerminator& rhs );
 
+    // appends the template's message as it is, like a message built
+    // between BeginMessage and EndMessage
+    OutboundPacketStream& operator<<( const MessageTemplate& rhs );
+
 private:
 
     char *BeginElement( char *beginPtr );
@@ -38,40 +38,169 @@
 #define INCLUDED_OSCPACK_OSCPACKETLISTENER_H
 
 #include "OscReceivedElements.h"
+#include "OscBundleScheduler.h"
 #include "../ip/PacketListener.h"
 
 
 namespace osc{
 
 class OscPacketListener : public PacketListener{ 
+public:
+    OscPacketListener()
+        : arrivalTimeNs_( 0 )
+        , scheduler_( 0 ) {}
+
+    virtual ~OscPacketListener()
+    {
+        if( scheduler_ )
+            scheduler_->Discard( this );
+    }
+
+    // with a scheduler, bundles whose time tag lies in the future are
+    // processed when the scheduler releases them instead of on arrival.
+    // 0, the default, processes every bundle on arrival. the scheduler
+    // must outlive the listener.
+    void SetBundleScheduler( BundleScheduler *scheduler )
+    {
+        if( scheduler_ && scheduler_ != scheduler )
+            scheduler_->Discard( this );
+        scheduler_ = scheduler;
+    }
+
 protected:
+    // called at the bundle's time tag when a scheduler is set, on arrival
+    // otherwise. nested bundles are processed with the outermost bundle.
     virtual void ProcessBundle( const osc::ReceivedBundle& b, 
 				const IpEndpointName& remoteEndpoint )
     {
-        // ignore bundle time tag for now
-
         for( ReceivedBundle::const_iterator i = b.ElementsBegin(); 
 				i != b.ElementsEnd(); ++i ){
-            if( i->IsBundle() )
-                ProcessBundle( ReceivedBundle(*i), remoteEndpoint );
-            else
-                ProcessMessage( ReceivedMessage(*i), remoteEndpoint );
+            if( i->IsBundle() ){
+                ReceivedBundle bundle;
+                ParseStatus status = ReceivedBundle::Parse( *i, bundle );
+                if( status == PARSE_OK )
+                    ProcessBundle( bundle, remoteEndpoint );
+                else
+                    ProcessMalformedPacket( status, BUNDLE_ELEMENT, i->Contents(), i->Size(), remoteEndpoint );
+            }else{
+                ReceivedMessage message;
+                ParseStatus status = ReceivedMessage::Parse( *i, message );
+                if( status == PARSE_OK )
+                    ProcessMessage( message, remoteEndpoint );
+                else
+                    ProcessMalformedPacket( status, MESSAGE_ELEMENT, i->Contents(), i->Size(), remoteEndpoint );
+            }
         }
     }
 
     virtual void ProcessMessage( const osc::ReceivedMessage& m, 
 				const IpEndpointName& remoteEndpoint ) = 0;
+
+    // what was being parsed when ProcessMalformedPacket() is called:
+    // the packet itself (its size was rejected), or a message or bundle,
+    // either the whole packet or an element of a bundle.
+    enum MalformedElementKind{
+        PACKET_ELEMENT,
+        MESSAGE_ELEMENT,
+        BUNDLE_ELEMENT
+    };
+
+    // called for a packet, or an element of a bundle, which failed to
+    // parse. the default throws the Malformed*Exception the throwing
+    // constructors would have, override it to drop bad input without
+    // unwinding. elements before a malformed one have been processed.
+    virtual void ProcessMalformedPacket( ParseStatus status, MalformedElementKind kind,
+                const char *data, int size, const IpEndpointName& remoteEndpoint )
+    {
+        (void) data;
+        (void) size;
+        (void) remoteEndpoint;
+        ThrowMalformed( status, kind );
+    }
+
+    // throws what ReceivedPacket(), ReceivedMessage() or ReceivedBundle()
+    // throw for status. size errors are reported against the element
+    // whose size it is, so a zero length message inside a bundle is a
+    // MalformedMessageException as before.
+    static void ThrowMalformed( ParseStatus status, MalformedElementKind kind )
+    {
+        switch( kind ){
+            case PACKET_ELEMENT:
+                throw MalformedPacketException( ParseStatusDescription( status ) );
+            case BUNDLE_ELEMENT:
+                throw MalformedBundleException( ParseStatusDescription( status ) );
+            case MESSAGE_ELEMENT:
+            default:
+                throw MalformedMessageException( ParseStatusDescription( status ) );
+        }
+    }
+
+    // arrival time of the packet currently being processed, in nanoseconds
+    // on the steady_clock timeline. 0 if the socket doesn't have receive
+    // timestamps enabled.
+    long long PacketArrivalTimeNs() const { return arrivalTimeNs_; }
     
 public:
 	virtual void ProcessPacket( const char *data, int size, 
 			const IpEndpointName& remoteEndpoint )
     {
-        osc::ReceivedPacket p( data, size );
-        if( p.IsBundle() )
-            ProcessBundle( ReceivedBundle(p), remoteEndpoint );
-        else
-            ProcessMessage( ReceivedMessage(p), remoteEndpoint );
+        osc::ReceivedPacket p;
+        ParseStatus status = ( size < 0 ) ? PARSE_INVALID_SIZE
+                : ReceivedPacket::Parse( data, (std::size_t)size, p );
+        if( status != PARSE_OK ){
+            ProcessMalformedPacket( status, PACKET_ELEMENT, data, size, remoteEndpoint );
+            return;
+        }
+
+        if( p.IsBundle() ){
+            ReceivedBundle bundle;
+            status = ReceivedBundle::Parse( p, bundle );
+            if( status != PARSE_OK )
+                ProcessMalformedPacket( status, BUNDLE_ELEMENT, data, size, remoteEndpoint );
+            else if( !scheduler_ || !scheduler_->Schedule( this, bundle, remoteEndpoint, arrivalTimeNs_ ) )
+                ProcessBundle( bundle, remoteEndpoint );
+        }else{
+            ReceivedMessage message;
+            status = ReceivedMessage::Parse( p, message );
+            if( status == PARSE_OK )
+                ProcessMessage( message, remoteEndpoint );
+            else
+                ProcessMalformedPacket( status, MESSAGE_ELEMENT, data, size, remoteEndpoint );
+        }
+    }
+
+    virtual void ProcessTimestampedPacket( const char *data, int size,
+			const IpEndpointName& remoteEndpoint, long long arrivalTimeNs )
+    {
+        arrivalTimeNs_ = arrivalTimeNs;
+        try{
+            ProcessPacket( data, size, remoteEndpoint );
+        }catch( ... ){
+            arrivalTimeNs_ = 0;
+            throw;
+        }
+        arrivalTimeNs_ = 0;
+    }
+
+private:
+    friend class BundleScheduler;
+
+    // arrival time is that of the packet which carried the bundle
+    void ProcessScheduledBundle( const osc::ReceivedBundle& b,
+            const IpEndpointName& remoteEndpoint, long long arrivalTimeNs )
+    {
+        arrivalTimeNs_ = arrivalTimeNs;
+        try{
+            ProcessBundle( b, remoteEndpoint );
+        }catch( ... ){
+            arrivalTimeNs_ = 0;
+            throw;
+        }
+        arrivalTimeNs_ = 0;
     }
+
+    long long arrivalTimeNs_;
+    BundleScheduler *scheduler_;
 };
 
 } // namespace osc
@@ -40,9 +40,41 @@
 
 #include <cstddef> // ptrdiff_t
 
+// SSE2 is part of every x86-64 target, AVX2 is used when the compiler is
+// told it may (e.g. -mavx2 or /arch:AVX2). other targets use the scalar scans,
+// as does any build with OSC_NO_SIMD defined (see tools/OscParseBench.cpp).
+#if defined(OSC_NO_SIMD)
+// scalar scans only
+#elif defined(__AVX2__)
+#define OSC_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OSC_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if (defined(OSC_SIMD_AVX2) || defined(OSC_SIMD_SSE2)) && defined(_MSC_VER)
+#include <intrin.h> // _BitScanForward
+#endif
+
 namespace osc{
 
 
+#if defined(OSC_SIMD_AVX2) || defined(OSC_SIMD_SSE2)
+// index of the lowest set bit, mask must not be zero
+static inline int LowestSetBit( unsigned int mask )
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward( &index, mask );
+    return (int)index;
+#else
+    return __builtin_ctz( mask );
+#endif
+}
+#endif
+
+
 // return the first 4 byte boundary after the end of a str4
 // be careful about calling this version if you don't know whether
 // the string is terminated correctly.
@@ -70,6 +102,32 @@ static inline const char* FindStr4End( const char *p, const char *end )
 	if( p[0] == '\0' )    // special case for SuperCollider integer address pattern
 		return p + 4;
 
+    // a str4 ends with the first 4 byte word whose last byte is zero, so
+    // only every fourth byte of the comparison mask matters
+#if defined(OSC_SIMD_AVX2)
+    const __m256i zero = _mm256_setzero_si256();
+    while( end - p >= 32 ){
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*)p ), zero ) ) & 0x88888888U;
+        if( mask )
+            return p + LowestSetBit( mask ) + 1;
+        p += 32;
+    }
+#endif
+#if defined(OSC_SIMD_AVX2) || defined(OSC_SIMD_SSE2)
+    const __m128i zero16 = _mm_setzero_si128();
+    while( end - p >= 16 ){
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(
+                _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)p ), zero16 ) ) & 0x8888U;
+        if( mask )
+            return p + LowestSetBit( mask ) + 1;
+        p += 16;
+    }
+
+    if( p >= end )
+        return 0;
+#endif
+
     p += 3;
     end -= 1;
 
@@ -83,6 +141,37 @@ static inline const char* FindStr4End( const char *p, const char *end )
 }
 
 
+// the number of consecutive int32 and float type tags starting at typeTag.
+// these make up most messages and take 4 bytes of argument data each, so
+// Init() checks a whole run at once. reads no further than limit, the end
+// of the padded type tag string.
+static inline std::size_t CountInt32AndFloatTypeTags( const char *typeTag, const char *limit )
+{
+    const char *p = typeTag;
+
+#if defined(OSC_SIMD_AVX2) || defined(OSC_SIMD_SSE2)
+    const __m128i int32Tags = _mm_set1_epi8( INT32_TYPE_TAG );
+    const __m128i floatTags = _mm_set1_epi8( FLOAT_TYPE_TAG );
+    while( limit - p >= 16 ){
+        const __m128i tags = _mm_loadu_si128( (const __m128i*)p );
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(
+                _mm_or_si128( _mm_cmpeq_epi8( tags, int32Tags ), _mm_cmpeq_epi8( tags, floatTags ) ) );
+        if( mask != 0xFFFFU )
+            return (std::size_t)(p - typeTag) + LowestSetBit( ~mask & 0xFFFFU );
+        p += 16;
+    }
+#else
+    (void)limit;
+#endif
+
+    // the type tag string is terminated, this stops at the '\0' at the latest
+    while( *p == INT32_TYPE_TAG || *p == FLOAT_TYPE_TAG )
+        ++p;
+
+    return (std::size_t)(p - typeTag);
+}
+
+
 // round up to the next highest multiple of 4. unless x is already a multiple of 4
 static inline uint32 RoundUp4( uint32 x ) 
 {
@@ -179,6 +268,30 @@ static inline uint64 ToUInt64( const char *p )
 
 //------------------------------------------------------------------------------
 
+const char *ParseStatusDescription( ParseStatus status )
+{
+    switch( status ){
+        case PARSE_OK: return "ok";
+        case PARSE_INVALID_SIZE: return "invalid element size";
+        case PARSE_ZERO_SIZE: return "zero length elements not permitted";
+        case PARSE_SIZE_NOT_MULTIPLE_OF_4: return "element size must be multiple of four";
+        case PARSE_UNTERMINATED_ADDRESS_PATTERN: return "unterminated address pattern";
+        case PARSE_MISSING_TYPE_TAGS: return "type tags not present";
+        case PARSE_UNTERMINATED_TYPE_TAGS: return "type tags were not terminated before end of message";
+        case PARSE_ARGUMENTS_EXCEED_SIZE: return "arguments exceed message size";
+        case PARSE_UNTERMINATED_STRING: return "unterminated string argument";
+        case PARSE_UNKNOWN_TYPE_TAG: return "unknown type tag";
+        case PARSE_UNTERMINATED_ARRAY: return "array was not terminated before end of message (expected ']' end of array tag)";
+        case PARSE_BUNDLE_TOO_SHORT: return "packet too short for bundle";
+        case PARSE_BAD_BUNDLE_HEADER: return "bad bundle address pattern";
+        case PARSE_BUNDLE_ELEMENT_SIZE_NOT_MULTIPLE_OF_4: return "bundle element size must be multiple of four";
+        case PARSE_BUNDLE_ELEMENT_EXCEEDS_SIZE: return "packet too short for bundle element";
+    }
+    return "malformed packet";
+}
+
+//------------------------------------------------------------------------------
+
 bool ReceivedPacket::IsBundle() const
 {
     return (Size() > 0 && Contents()[0] == '#');
@@ -559,14 +672,49 @@ void ReceivedMessageArgumentIterator::Advance()
 ReceivedMessage::ReceivedMessage( const ReceivedPacket& packet )
     : addressPattern_( packet.Contents() )
 {
-    Init( packet.Contents(), packet.Size() );
+    ParseStatus status = Init( packet.Contents(), packet.Size() );
+    if( status != PARSE_OK )
+        throw MalformedMessageException( ParseStatusDescription( status ) );
 }
 
 
 ReceivedMessage::ReceivedMessage( const ReceivedBundleElement& bundleElement )
     : addressPattern_( bundleElement.Contents() )
 {
-    Init( bundleElement.Contents(), bundleElement.Size() );
+    ParseStatus status = Init( bundleElement.Contents(), bundleElement.Size() );
+    if( status != PARSE_OK )
+        throw MalformedMessageException( ParseStatusDescription( status ) );
+}
+
+
+ReceivedMessage::ReceivedMessage()
+    : addressPattern_( "" )
+    , typeTagsBegin_( 0 )
+    , typeTagsEnd_( 0 )
+    , arguments_( 0 )
+{
+}
+
+
+ParseStatus ReceivedMessage::Parse( const ReceivedPacket& packet, ReceivedMessage& message )
+{
+    ReceivedMessage result;
+    result.addressPattern_ = packet.Contents();
+    ParseStatus status = result.Init( packet.Contents(), packet.Size() );
+    if( status == PARSE_OK )
+        message = result;
+    return status;
+}
+
+
+ParseStatus ReceivedMessage::Parse( const ReceivedBundleElement& bundleElement, ReceivedMessage& message )
+{
+    ReceivedMessage result;
+    result.addressPattern_ = bundleElement.Contents();
+    ParseStatus status = result.Init( bundleElement.Contents(), bundleElement.Size() );
+    if( status == PARSE_OK )
+        message = result;
+    return status;
 }
 
 
@@ -582,23 +730,23 @@ uint32 ReceivedMessage::AddressPatternAsUInt32() const
 }
 
 
-void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size )
+ParseStatus ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size )
 {
     if( !IsValidElementSizeValue(size) )
-        throw MalformedMessageException( "invalid message size" );
+        return PARSE_INVALID_SIZE;
 
     if( size == 0 )
-        throw MalformedMessageException( "zero length messages not permitted" );
+        return PARSE_ZERO_SIZE;
 
     if( !IsMultipleOf4(size) )
-        throw MalformedMessageException( "message size must be multiple of four" );
+        return PARSE_SIZE_NOT_MULTIPLE_OF_4;
 
     const char *end = message + size;
 
     typeTagsBegin_ = FindStr4End( addressPattern_, end );
     if( typeTagsBegin_ == 0 ){
         // address pattern was not terminated before end
-        throw MalformedMessageException( "unterminated address pattern" );
+        return PARSE_UNTERMINATED_ADDRESS_PATTERN;
     }
 
     if( typeTagsBegin_ == end ){
@@ -609,7 +757,7 @@ void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size
             
     }else{
         if( *typeTagsBegin_ != ',' )
-            throw MalformedMessageException( "type tags not present" );
+            return PARSE_MISSING_TYPE_TAGS;
 
         if( *(typeTagsBegin_ + 1) == '\0' ){
             // zero length type tags
@@ -622,7 +770,7 @@ void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size
                 
             arguments_ = FindStr4End( typeTagsBegin_, end );
             if( arguments_ == 0 ){
-                throw MalformedMessageException( "type tags were not terminated before end of message" );
+                return PARSE_UNTERMINATED_TYPE_TAGS;
             }
 
             ++typeTagsBegin_; // advance past initial ','
@@ -632,6 +780,16 @@ void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size
             unsigned int arrayLevel = 0;
                         
             do{
+                std::size_t run = CountInt32AndFloatTypeTags( typeTag, arguments_ );
+                if( run > 0 ){
+                    if( (std::size_t)(end - argument) / 4 < run )
+                        return PARSE_ARGUMENTS_EXCEED_SIZE;
+                    argument += 4 * run;
+                    typeTag += run;
+                    if( *typeTag == '\0' )
+                        break;
+                }
+
                 switch( *typeTag ){
                     case TRUE_TYPE_TAG:
                     case FALSE_TYPE_TAG:
@@ -659,56 +817,54 @@ void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size
                     case RGBA_COLOR_TYPE_TAG:
                     case MIDI_MESSAGE_TYPE_TAG:
 
-                        if( argument == end )
-                            throw MalformedMessageException( "arguments exceed message size" );
+                        if( end - argument < 4 )
+                            return PARSE_ARGUMENTS_EXCEED_SIZE;
                         argument += 4;
-                        if( argument > end )
-                            throw MalformedMessageException( "arguments exceed message size" );
                         break;
 
                     case INT64_TYPE_TAG:
                     case TIME_TAG_TYPE_TAG:
                     case DOUBLE_TYPE_TAG:
 
-                        if( argument == end )
-                            throw MalformedMessageException( "arguments exceed message size" );
+                        if( end - argument < 8 )
+                            return PARSE_ARGUMENTS_EXCEED_SIZE;
                         argument += 8;
-                        if( argument > end )
-                            throw MalformedMessageException( "arguments exceed message size" );
                         break;
 
                     case STRING_TYPE_TAG: 
                     case SYMBOL_TYPE_TAG:
                     
                         if( argument == end )
-                            throw MalformedMessageException( "arguments exceed message size" );
+                            return PARSE_ARGUMENTS_EXCEED_SIZE;
                         argument = FindStr4End( argument, end );
                         if( argument == 0 )
-                            throw MalformedMessageException( "unterminated string argument" );
+                            return PARSE_UNTERMINATED_STRING;
                         break;
 
                     case BLOB_TYPE_TAG:
                         {
-                            if( argument + osc::OSC_SIZEOF_INT32 > end )
-                                MalformedMessageException( "arguments exceed message size" );
+                            if( end - argument < osc::OSC_SIZEOF_INT32 )
+                                return PARSE_ARGUMENTS_EXCEED_SIZE;
                                 
                             // treat blob size as an unsigned int for the purposes of this calculation
                             uint32 blobSize = ToUInt32( argument );
-                            argument = argument + osc::OSC_SIZEOF_INT32 + RoundUp4( blobSize );
-                            if( argument > end )
-                                MalformedMessageException( "arguments exceed message size" );
+                            argument += osc::OSC_SIZEOF_INT32;
+                            // compare before rounding up, which wraps for the largest sizes
+                            if( blobSize > (uint32)(end - argument) || RoundUp4( blobSize ) > (uint32)(end - argument) )
+                                return PARSE_ARGUMENTS_EXCEED_SIZE;
+                            argument += RoundUp4( blobSize );
                         }
                         break;
                         
                     default:
-                        throw MalformedMessageException( "unknown type tag" );
+                        return PARSE_UNKNOWN_TYPE_TAG;
                 }
 
             }while( *++typeTag != '\0' );
             typeTagsEnd_ = typeTag;
 
             if( arrayLevel !=  0 )
-                throw MalformedMessageException( "array was not terminated before end of message (expected ']' end of array tag)" );
+                return PARSE_UNTERMINATED_ARRAY;
         }
 
         // These invariants should be guaranteed by the above code.
@@ -719,6 +875,8 @@ void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size
         assert( argumentCount <= OSC_INT32_MAX );
 #endif
     }
+
+    return PARSE_OK;
 }
 
 //------------------------------------------------------------------------------
@@ -726,28 +884,60 @@ void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size
 ReceivedBundle::ReceivedBundle( const ReceivedPacket& packet )
     : elementCount_( 0 )
 {
-    Init( packet.Contents(), packet.Size() );
+    ParseStatus status = Init( packet.Contents(), packet.Size() );
+    if( status != PARSE_OK )
+        throw MalformedBundleException( ParseStatusDescription( status ) );
 }
 
 
 ReceivedBundle::ReceivedBundle( const ReceivedBundleElement& bundleElement )
     : elementCount_( 0 )
 {
-    Init( bundleElement.Contents(), bundleElement.Size() );
+    ParseStatus status = Init( bundleElement.Contents(), bundleElement.Size() );
+    if( status != PARSE_OK )
+        throw MalformedBundleException( ParseStatusDescription( status ) );
+}
+
+
+ReceivedBundle::ReceivedBundle()
+    : timeTag_( 0 )
+    , end_( 0 )
+    , elementCount_( 0 )
+{
+}
+
+
+ParseStatus ReceivedBundle::Parse( const ReceivedPacket& packet, ReceivedBundle& bundle )
+{
+    ReceivedBundle result;
+    ParseStatus status = result.Init( packet.Contents(), packet.Size() );
+    if( status == PARSE_OK )
+        bundle = result;
+    return status;
+}
+
+
+ParseStatus ReceivedBundle::Parse( const ReceivedBundleElement& bundleElement, ReceivedBundle& bundle )
+{
+    ReceivedBundle result;
+    ParseStatus status = result.Init( bundleElement.Contents(), bundleElement.Size() );
+    if( status == PARSE_OK )
+        bundle = result;
+    return status;
 }
 
 
-void ReceivedBundle::Init( const char *bundle, osc_bundle_element_size_t size )
+ParseStatus ReceivedBundle::Init( const char *bundle, osc_bundle_element_size_t size )
 {
 
     if( !IsValidElementSizeValue(size) )
-        throw MalformedBundleException( "invalid bundle size" );
+        return PARSE_INVALID_SIZE;
 
     if( size < 16 )
-        throw MalformedBundleException( "packet too short for bundle" );
+        return PARSE_BUNDLE_TOO_SHORT;
 
     if( !IsMultipleOf4(size) )
-        throw MalformedBundleException( "bundle size must be multiple of four" );
+        return PARSE_SIZE_NOT_MULTIPLE_OF_4;
 
     if( bundle[0] != '#'
         || bundle[1] != 'b'
@@ -757,7 +947,7 @@ void ReceivedBundle::Init( const char *bundle, osc_bundle_element_size_t size )
         || bundle[5] != 'l'
         || bundle[6] != 'e'
         || bundle[7] != '\0' )
-            throw MalformedBundleException( "bad bundle address pattern" );    
+            return PARSE_BAD_BUNDLE_HEADER;
 
     end_ = bundle + size;
 
@@ -766,23 +956,23 @@ void ReceivedBundle::Init( const char *bundle, osc_bundle_element_size_t size )
     const char *p = timeTag_ + 8;
         
     while( p < end_ ){
-        if( p + osc::OSC_SIZEOF_INT32 > end_ )
-            throw MalformedBundleException( "packet too short for elementSize" );
+        if( end_ - p < osc::OSC_SIZEOF_INT32 )
+            return PARSE_BUNDLE_ELEMENT_EXCEEDS_SIZE;
 
         // treat element size as an unsigned int for the purposes of this calculation
         uint32 elementSize = ToUInt32( p );
         if( (elementSize & ((uint32)0x03)) != 0 )
-            throw MalformedBundleException( "bundle element size must be multiple of four" );
+            return PARSE_BUNDLE_ELEMENT_SIZE_NOT_MULTIPLE_OF_4;
 
-        p += osc::OSC_SIZEOF_INT32 + elementSize;
-        if( p > end_ )
-            throw MalformedBundleException( "packet too short for bundle element" );
+        p += osc::OSC_SIZEOF_INT32;
+        if( elementSize > (uint32)(end_ - p) )
+            return PARSE_BUNDLE_ELEMENT_EXCEEDS_SIZE;
+        p += elementSize;
 
         ++elementCount_;
     }
 
-    if( p != end_ )
-        throw MalformedBundleException( "bundle contents " );
+    return PARSE_OK;
 }
 
 
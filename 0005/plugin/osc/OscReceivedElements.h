@@ -40,9 +40,11 @@
 #include <cassert>
 #include <cstddef>
 #include <cstring> // size_t
+#include <tuple>
 
 #include "OscTypes.h"
 #include "OscException.h"
+#include "OscHostEndianness.h"
 
 
 namespace osc{
@@ -85,6 +87,31 @@ public:
 };
 
 
+// Result of the non-throwing Parse() functions below. The constructors of
+// ReceivedPacket, ReceivedMessage and ReceivedBundle run the same checks
+// and throw the matching Malformed*Exception with ParseStatusDescription()
+// as its message.
+enum ParseStatus{
+    PARSE_OK = 0,
+    PARSE_INVALID_SIZE,
+    PARSE_ZERO_SIZE,
+    PARSE_SIZE_NOT_MULTIPLE_OF_4,
+    PARSE_UNTERMINATED_ADDRESS_PATTERN,
+    PARSE_MISSING_TYPE_TAGS,
+    PARSE_UNTERMINATED_TYPE_TAGS,
+    PARSE_ARGUMENTS_EXCEED_SIZE,
+    PARSE_UNTERMINATED_STRING,
+    PARSE_UNKNOWN_TYPE_TAG,
+    PARSE_UNTERMINATED_ARRAY,
+    PARSE_BUNDLE_TOO_SHORT,
+    PARSE_BAD_BUNDLE_HEADER,
+    PARSE_BUNDLE_ELEMENT_SIZE_NOT_MULTIPLE_OF_4,
+    PARSE_BUNDLE_ELEMENT_EXCEEDS_SIZE
+};
+
+const char *ParseStatusDescription( ParseStatus status );
+
+
 class ReceivedPacket{
 public:
     // Although the OSC spec is not entirely clear on this, we only support
@@ -96,6 +123,25 @@ public:
         : contents_( contents )
         , size_( ValidateSize(size) ) {}
 
+    // an empty packet to be filled in by Parse()
+    ReceivedPacket()
+        : contents_( 0 )
+        , size_( 0 ) {}
+
+    // non-throwing construction. on PARSE_OK packet refers to contents,
+    // otherwise it is left unchanged.
+    static ParseStatus Parse( const char *contents, std::size_t size, ReceivedPacket& packet )
+    {
+        osc_bundle_element_size_t elementSize = (size > (std::size_t)OSC_BUNDLE_ELEMENT_SIZE_MAX)
+                ? (osc_bundle_element_size_t)-1 : (osc_bundle_element_size_t)size;
+        ParseStatus status = CheckSize( elementSize );
+        if( status == PARSE_OK ){
+            packet.contents_ = contents;
+            packet.size_ = elementSize;
+        }
+        return status;
+    }
+
     ReceivedPacket( const char *contents, std::size_t size )
         : contents_( contents )
         , size_( ValidateSize( (osc_bundle_element_size_t)size ) ) {}
@@ -116,7 +162,7 @@ private:
     const char *contents_;
     osc_bundle_element_size_t size_;
 
-    static osc_bundle_element_size_t ValidateSize( osc_bundle_element_size_t size )
+    static ParseStatus CheckSize( osc_bundle_element_size_t size )
     {
         // sanity check integer types declared in OscTypes.h 
         // you'll need to fix OscTypes.h if any of these asserts fail
@@ -126,13 +172,22 @@ private:
         assert( sizeof(osc::uint64) == 8 );
 
         if( !IsValidElementSizeValue(size) )
-            throw MalformedPacketException( "invalid packet size" );
+            return PARSE_INVALID_SIZE;
 
         if( size == 0 )
-            throw MalformedPacketException( "zero length elements not permitted" );
+            return PARSE_ZERO_SIZE;
 
         if( !IsMultipleOf4(size) )
-            throw MalformedPacketException( "element size must be multiple of four" );
+            return PARSE_SIZE_NOT_MULTIPLE_OF_4;
+
+        return PARSE_OK;
+    }
+
+    static osc_bundle_element_size_t ValidateSize( osc_bundle_element_size_t size )
+    {
+        ParseStatus status = CheckSize( size );
+        if( status != PARSE_OK )
+            throw MalformedPacketException( ParseStatusDescription( status ) );
 
         return size;
     }
@@ -471,12 +526,135 @@ public:
 };
 
 
+namespace detail{
+
+// reads a big-endian value of a 4 or 8 byte argument type
+template< typename T >
+inline T FromBigEndian( const char *p )
+{
+    union{
+        T value;
+        char c[ sizeof(T) ];
+    } u;
+
+#ifdef OSC_HOST_LITTLE_ENDIAN
+    for( std::size_t i = 0; i < sizeof(T); ++i )
+        u.c[i] = p[ sizeof(T) - 1 - i ];
+#else
+    std::memcpy( u.c, p, sizeof(T) );
+#endif
+
+    return u.value;
+}
+
+// the first 4 byte boundary after the end of a str4 that has been
+// validated by ReceivedMessage, found the same way the parser finds it
+inline const char* SkipStr4( const char *p )
+{
+    if( p[0] == '\0' )
+        return p + 4;
+
+    p += 3;
+
+    while( *p )
+        p += 4;
+
+    return p + 1;
+}
+
+// ArgumentDecoder<T> gives the type tag decoded into a T and reads one
+// argument of that type, returning the start of the next argument.
+// only types with a single fixed type tag are decodable, so bool, nil,
+// infinitum and arrays must be read with the argument iterator.
+template< typename T >
+struct ArgumentDecoder;
+
+#define OSC_FIXED_SIZE_ARGUMENT_DECODER( type, tag, wireType ) \
+    template<> struct ArgumentDecoder< type >{ \
+        static constexpr char typeTag = tag; \
+        static const char* Decode( const char *p, type& value ) \
+        { \
+            value = type( FromBigEndian< wireType >( p ) ); \
+            return p + sizeof(wireType); \
+        } \
+    };
+
+OSC_FIXED_SIZE_ARGUMENT_DECODER( int32, INT32_TYPE_TAG, int32 )
+OSC_FIXED_SIZE_ARGUMENT_DECODER( float, FLOAT_TYPE_TAG, float )
+OSC_FIXED_SIZE_ARGUMENT_DECODER( char, CHAR_TYPE_TAG, int32 )
+OSC_FIXED_SIZE_ARGUMENT_DECODER( RgbaColor, RGBA_COLOR_TYPE_TAG, uint32 )
+OSC_FIXED_SIZE_ARGUMENT_DECODER( MidiMessage, MIDI_MESSAGE_TYPE_TAG, uint32 )
+OSC_FIXED_SIZE_ARGUMENT_DECODER( int64, INT64_TYPE_TAG, int64 )
+OSC_FIXED_SIZE_ARGUMENT_DECODER( TimeTag, TIME_TAG_TYPE_TAG, uint64 )
+OSC_FIXED_SIZE_ARGUMENT_DECODER( double, DOUBLE_TYPE_TAG, double )
+
+#undef OSC_FIXED_SIZE_ARGUMENT_DECODER
+
+template<> struct ArgumentDecoder< const char* >{
+    static constexpr char typeTag = STRING_TYPE_TAG;
+    static const char* Decode( const char *p, const char*& value )
+    {
+        value = p;
+        return SkipStr4( p );
+    }
+};
+
+template<> struct ArgumentDecoder< Symbol >{
+    static constexpr char typeTag = SYMBOL_TYPE_TAG;
+    static const char* Decode( const char *p, Symbol& value )
+    {
+        value = Symbol( p );
+        return SkipStr4( p );
+    }
+};
+
+template<> struct ArgumentDecoder< Blob >{
+    static constexpr char typeTag = BLOB_TYPE_TAG;
+    static const char* Decode( const char *p, Blob& value )
+    {
+        osc_bundle_element_size_t size = FromBigEndian< osc_bundle_element_size_t >( p );
+        value = Blob( p + osc::OSC_SIZEOF_INT32, size );
+        return p + osc::OSC_SIZEOF_INT32 + ((size + 3) & ~0x03);
+    }
+};
+
+// the type tag string of a message whose arguments are exactly Args
+template< typename... Args >
+struct TypeTagSignature{
+    static constexpr char value[ sizeof...(Args) + 1 ] = { ArgumentDecoder< Args >::typeTag..., '\0' };
+};
+
+template< typename... Args >
+constexpr char TypeTagSignature< Args... >::value[ sizeof...(Args) + 1 ];
+
+template< std::size_t... I >
+struct IndexSequence{};
+
+template< std::size_t N, std::size_t... I >
+struct MakeIndexSequence : MakeIndexSequence< N - 1, N - 1, I... >{};
+
+template< std::size_t... I >
+struct MakeIndexSequence< 0, I... >{
+    typedef IndexSequence< I... > type;
+};
+
+} // namespace detail
+
+
 class ReceivedMessage{
-    void Init( const char *bundle, osc_bundle_element_size_t size );
+    ParseStatus Init( const char *message, osc_bundle_element_size_t size );
 public:
     explicit ReceivedMessage( const ReceivedPacket& packet );
     explicit ReceivedMessage( const ReceivedBundleElement& bundleElement );
 
+    // an empty message to be filled in by Parse()
+    ReceivedMessage();
+
+    // non-throwing construction. validates the message and on PARSE_OK
+    // fills in message, otherwise message is left unchanged.
+    static ParseStatus Parse( const ReceivedPacket& packet, ReceivedMessage& message );
+    static ParseStatus Parse( const ReceivedBundleElement& bundleElement, ReceivedMessage& message );
+
 	const char *AddressPattern() const { return addressPattern_; }
 
 	// Support for non-standard SuperCollider integer address patterns:
@@ -505,7 +683,43 @@ public:
         return ReceivedMessageArgumentStream( ArgumentsBegin(), ArgumentsEnd() );
     }
 
+    // typed decoding of the leading arguments in one step. the type tags
+    // are compared against the signature of Args, e.g. "sfff" for
+    // ( const char*, float, float, float ), and only if they match are
+    // the arguments read into values. further arguments are ignored.
+    // returns false and leaves values unchanged on a mismatch.
+    template< typename... Args >
+    bool Decode( Args&... values ) const
+    {
+        if( !HasLeadingTypeTags( detail::TypeTagSignature< Args... >::value, sizeof...(Args) ) )
+            return false;
+
+        const char *p = arguments_;
+        int expand[] = { 0, ( p = detail::ArgumentDecoder< Args >::Decode( p, values ), 0 )... };
+        (void)expand;
+        (void)p;
+        return true;
+    }
+
+    template< typename... Args >
+    bool Decode( std::tuple< Args... >& values ) const
+    {
+        return DecodeTuple( values, typename detail::MakeIndexSequence< sizeof...(Args) >::type() );
+    }
+
 private:
+    bool HasLeadingTypeTags( const char *typeTags, std::size_t count ) const
+    {
+        return count == 0 || ( ArgumentCount() >= count
+                && std::memcmp( typeTagsBegin_, typeTags, count ) == 0 );
+    }
+
+    template< typename Tuple, std::size_t... I >
+    bool DecodeTuple( Tuple& values, detail::IndexSequence< I... > ) const
+    {
+        return Decode( std::get< I >( values )... );
+    }
+
 	const char *addressPattern_;
 	const char *typeTagsBegin_;
 	const char *typeTagsEnd_;
@@ -514,13 +728,26 @@ private:
 
 
 class ReceivedBundle{
-    void Init( const char *message, osc_bundle_element_size_t size );
+    ParseStatus Init( const char *bundle, osc_bundle_element_size_t size );
 public:
     explicit ReceivedBundle( const ReceivedPacket& packet );
     explicit ReceivedBundle( const ReceivedBundleElement& bundleElement );
 
+    // an empty bundle to be filled in by Parse()
+    ReceivedBundle();
+
+    // non-throwing construction. validates the bundle header and element
+    // sizes, not the elements themselves, and on PARSE_OK fills in bundle.
+    static ParseStatus Parse( const ReceivedPacket& packet, ReceivedBundle& bundle );
+    static ParseStatus Parse( const ReceivedBundleElement& bundleElement, ReceivedBundle& bundle );
+
     uint64 TimeTag() const;
 
+    // the whole bundle, from the "#bundle" header to the end of the last element
+    const char *Contents() const { return timeTag_ - 8; }
+    osc_bundle_element_size_t Size() const
+        { return static_cast<osc_bundle_element_size_t>(end_ - Contents()); }
+
     uint32 ElementCount() const { return elementCount_; }
 
     typedef ReceivedBundleElementIterator const_iterator;
@@ -0,0 +1,135 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "OscStr4HashTable.h"
+
+#include <cstring>
+
+
+namespace osc{
+
+Str4HashTable::Str4HashTable()
+    : seed_( 0 )
+    , mask_( 0 )
+{
+}
+
+
+std::size_t Str4HashTable::Add( const char *key )
+{
+    std::size_t length = std::strlen( key );
+    std::vector<char> padded( key, key + length );
+    padded.resize( (length + 4) & ~((std::size_t)0x03), '\0' );
+
+    int existing = Find( &padded[0] );
+    if( existing >= 0 )
+        return (std::size_t)existing;
+
+    keys_.push_back( padded );
+    Rebuild();
+    return keys_.size() - 1;
+}
+
+
+int Str4HashTable::Find( const char *str4 ) const
+{
+    if( slots_.empty() || str4[0] == '\0' )
+        return -1;
+
+    std::size_t size;
+    int slot = slots_[ Hash( str4, seed_, size ) & mask_ ];
+    if( slot < 0 )
+        return -1;
+
+    const std::vector<char>& key = keys_[ slot ];
+    if( key.size() != size || std::memcmp( &key[0], str4, size ) != 0 )
+        return -1;
+
+    return slot;
+}
+
+
+// hashes the 4 byte words of a str4 up to and including the word that
+// ends in a zero byte, and returns the padded size in size.
+uint32 Str4HashTable::Hash( const char *str4, uint32 seed, std::size_t& size )
+{
+    uint32 h = seed;
+    const char *p = str4;
+    do{
+        uint32 word;
+        std::memcpy( &word, p, 4 );
+        h = (h ^ word) * 0x9E3779B1U;
+        h ^= h >> 15;
+        p += 4;
+    }while( p[-1] != '\0' );
+
+    size = (std::size_t)(p - str4);
+    return h;
+}
+
+
+void Str4HashTable::Rebuild()
+{
+    // keep the table at most half full, doubling it when no seed
+    // separates all keys after a few tries
+    std::size_t tableSize = 4;
+    while( tableSize < keys_.size() * 2 )
+        tableSize *= 2;
+
+    std::vector<int> slots;
+    for( ;; tableSize *= 2 ){
+        for( uint32 seed = 1; seed <= 32; ++seed ){
+            slots.assign( tableSize, -1 );
+            std::size_t i = 0;
+            for( ; i < keys_.size(); ++i ){
+                std::size_t size;
+                uint32 slot = Hash( &keys_[i][0], seed, size ) & (uint32)(tableSize - 1);
+                if( slots[ slot ] >= 0 )
+                    break;
+                slots[ slot ] = (int)i;
+            }
+
+            if( i == keys_.size() ){
+                slots_.swap( slots );
+                seed_ = seed;
+                mask_ = (uint32)(tableSize - 1);
+                return;
+            }
+        }
+    }
+}
+
+} // namespace osc
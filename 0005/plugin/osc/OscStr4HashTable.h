@@ -0,0 +1,84 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCSTR4HASHTABLE_H
+#define INCLUDED_OSCPACK_OSCSTR4HASHTABLE_H
+
+#include <cstddef> // size_t
+#include <vector>
+
+#include "OscTypes.h"
+
+
+namespace osc{
+
+/*
+    Str4HashTable maps a fixed set of strings to their indices with a
+    perfect hash: the table is rebuilt by each Add() with a seed under
+    which no two keys share a slot, so a lookup is one hash and one
+    compare against the single candidate.
+
+    keys are hashed a 4 byte word at a time in their zero padded OSC
+    form, which is how addresses and string arguments lie in a received
+    packet. the strings passed to Find() must be padded that way.
+*/
+class Str4HashTable{
+public:
+    Str4HashTable();
+
+    // returns the index of key, keys are numbered from zero in the order
+    // they are added. adding a key again returns its first index.
+    std::size_t Add( const char *key );
+
+    std::size_t Size() const { return keys_.size(); }
+
+    // the index of the key equal to str4, or -1. str4 must be zero padded
+    // to a multiple of 4 bytes. a zero first byte never matches.
+    int Find( const char *str4 ) const;
+
+private:
+    static uint32 Hash( const char *str4, uint32 seed, std::size_t& size );
+    void Rebuild();
+
+    std::vector< std::vector<char> > keys_; // zero padded to a multiple of 4 bytes
+    std::vector<int> slots_; // index into keys_ or -1
+    uint32 seed_;
+    uint32 mask_;
+};
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCPACK_OSCSTR4HASHTABLE_H */
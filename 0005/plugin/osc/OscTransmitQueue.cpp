@@ -0,0 +1,225 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "OscTransmitQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+#include "OscOutboundPacketStream.h"
+#include "OscTypes.h"
+
+
+namespace osc{
+
+namespace{
+
+// "#bundle\0" followed by the immediate time tag
+const char BUNDLE_HEADER[16] = {
+    '#', 'b', 'u', 'n', 'd', 'l', 'e', '\0',
+    0, 0, 0, 0, 0, 0, 0, 1
+};
+
+const std::size_t BUNDLE_HEADER_SIZE = sizeof(BUNDLE_HEADER);
+const std::size_t ELEMENT_SIZE_SIZE = 4;
+
+
+void AppendUInt32( std::vector<char>& v, uint32 x )
+{
+    char bytes[4];
+    bytes[0] = static_cast<char>( (x >> 24) & 0xFF );
+    bytes[1] = static_cast<char>( (x >> 16) & 0xFF );
+    bytes[2] = static_cast<char>( (x >> 8) & 0xFF );
+    bytes[3] = static_cast<char>( x & 0xFF );
+    v.insert( v.end(), bytes, bytes + 4 );
+}
+
+
+long long MonotonicTimeNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+} // anonymous namespace
+
+
+TransmitQueue::TransmitQueue( UdpSocket& socket, std::size_t maxDatagramSize )
+    : socket_( socket )
+    , maxDatagramSize_( maxDatagramSize )
+    , flushTimeoutNs_( -1 )
+    , datagramCount_( 0 )
+    , packetCount_( 0 )
+    , oldestQueueTimeNs_( 0 )
+{
+}
+
+
+TransmitQueue::~TransmitQueue()
+{
+}
+
+
+void TransmitQueue::AddDestination( const IpEndpointName& destination )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    if( std::find( destinations_.begin(), destinations_.end(), destination ) == destinations_.end() )
+        destinations_.push_back( destination );
+}
+
+
+void TransmitQueue::RemoveDestination( const IpEndpointName& destination )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    destinations_.erase( std::remove( destinations_.begin(), destinations_.end(), destination ),
+            destinations_.end() );
+}
+
+
+void TransmitQueue::SetFlushTimeout( int timeoutMilliseconds )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    flushTimeoutNs_ = ( timeoutMilliseconds < 0 ) ? -1 : (long long)timeoutMilliseconds * 1000000;
+}
+
+
+void TransmitQueue::Queue( const OutboundPacketStream& packet )
+{
+    Queue( packet.Data(), packet.Size() );
+}
+
+
+void TransmitQueue::Queue( const char *data, std::size_t size )
+{
+    // bundle elements must be a multiple of 4 bytes, which all
+    // well formed packets are
+    assert( size > 0 && (size & 0x03) == 0 );
+
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    if( packetCount_ == 0 )
+        oldestQueueTimeNs_ = MonotonicTimeNs();
+
+    Datagram *current = ( datagramCount_ > 0 ) ? &datagrams_[ datagramCount_ - 1 ] : 0;
+    if( !current || current->data.size() + ELEMENT_SIZE_SIZE + size > maxDatagramSize_ ){
+        if( datagramCount_ == datagrams_.size() )
+            datagrams_.push_back( Datagram() );
+        current = &datagrams_[ datagramCount_++ ];
+        current->data.clear();
+        current->data.insert( current->data.end(), BUNDLE_HEADER, BUNDLE_HEADER + BUNDLE_HEADER_SIZE );
+        current->elementCount = 0;
+    }
+
+    AppendUInt32( current->data, static_cast<uint32>( size ) );
+    current->data.insert( current->data.end(), data, data + size );
+    ++current->elementCount;
+    ++packetCount_;
+}
+
+
+std::size_t TransmitQueue::Flush()
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    return FlushLocked();
+}
+
+
+std::size_t TransmitQueue::FlushLocked()
+{
+    if( datagramCount_ == 0 )
+        return 0;
+
+    outgoing_.clear();
+    for( std::size_t i=0; i < datagramCount_; ++i ){
+        const Datagram& datagram = datagrams_[i];
+
+        OutgoingDatagram outgoing;
+        if( datagram.elementCount == 1 ){
+            // send a lone packet as is
+            outgoing.data = &datagram.data[0] + BUNDLE_HEADER_SIZE + ELEMENT_SIZE_SIZE;
+            outgoing.size = datagram.data.size() - BUNDLE_HEADER_SIZE - ELEMENT_SIZE_SIZE;
+        }else{
+            outgoing.data = &datagram.data[0];
+            outgoing.size = datagram.data.size();
+        }
+
+        for( std::vector<IpEndpointName>::const_iterator j = destinations_.begin();
+                j != destinations_.end(); ++j ){
+            outgoing.remoteEndpoint = *j;
+            outgoing_.push_back( outgoing );
+        }
+    }
+
+    std::size_t sent = 0;
+    if( !outgoing_.empty() )
+        sent = socket_.SendMultiple( &outgoing_[0], outgoing_.size() );
+
+    datagramCount_ = 0;
+    packetCount_ = 0;
+
+    return sent;
+}
+
+
+void TransmitQueue::TimerExpired()
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    if( packetCount_ == 0 || flushTimeoutNs_ < 0 )
+        return;
+
+    if( MonotonicTimeNs() - oldestQueueTimeNs_ >= flushTimeoutNs_ )
+        FlushLocked();
+}
+
+
+std::size_t TransmitQueue::QueuedPacketCount() const
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    return packetCount_;
+}
+
+
+std::size_t TransmitQueue::QueuedDatagramCount() const
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    return datagramCount_;
+}
+
+} // namespace osc
+
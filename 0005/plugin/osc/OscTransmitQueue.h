@@ -0,0 +1,125 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCTRANSMITQUEUE_H
+#define INCLUDED_OSCPACK_OSCTRANSMITQUEUE_H
+
+#include <cstddef> // size_t
+#include <mutex>
+#include <vector>
+
+#include "../ip/IpEndpointName.h"
+#include "../ip/TimerListener.h"
+#include "../ip/UdpSocket.h"
+
+
+namespace osc{
+
+class OutboundPacketStream;
+
+
+/*
+    TransmitQueue collects outgoing packets and coalesces them into bundles
+    no larger than maxDatagramSize bytes. Queued datagrams are sent to every
+    destination with a single UdpSocket::SendMultiple() call when Flush() is
+    called, usually once per frame.
+
+    A flush timeout bounds the latency of packets which are queued between
+    frames: attach the queue to a SocketReceiveMultiplexer as a periodic
+    timer listener and TimerExpired() flushes once the oldest queued
+    packet has waited for the timeout.
+
+    Datagrams holding a single packet are sent without the bundle wrapper.
+    A packet too large to share a datagram is sent on its own.
+*/
+class TransmitQueue : public TimerListener{
+public:
+    // 1500 byte ethernet MTU less the IPv4 and UDP headers
+    enum { DEFAULT_MAX_DATAGRAM_SIZE = 1472 };
+
+    TransmitQueue( UdpSocket& socket, std::size_t maxDatagramSize=DEFAULT_MAX_DATAGRAM_SIZE );
+    virtual ~TransmitQueue();
+
+    void AddDestination( const IpEndpointName& destination );
+    void RemoveDestination( const IpEndpointName& destination );
+
+    // zero flushes on every TimerExpired() call, negative disables the timeout
+    void SetFlushTimeout( int timeoutMilliseconds );
+
+    // the packet is copied, the stream may be reused immediately
+    void Queue( const OutboundPacketStream& packet );
+    void Queue( const char *data, std::size_t size );
+
+    // sends all queued datagrams, returns the number of datagrams sent
+    // (counting each destination separately)
+    std::size_t Flush();
+
+    virtual void TimerExpired();
+
+    std::size_t QueuedPacketCount() const;
+    std::size_t QueuedDatagramCount() const;
+
+private:
+    TransmitQueue( const TransmitQueue& ); // no copying
+    TransmitQueue& operator=( const TransmitQueue& );
+
+    struct Datagram{
+        std::vector<char> data;
+        std::size_t elementCount;
+    };
+
+    std::size_t FlushLocked();
+
+    UdpSocket& socket_;
+    const std::size_t maxDatagramSize_;
+
+    mutable std::mutex mutex_;
+    std::vector<IpEndpointName> destinations_;
+    long long flushTimeoutNs_;
+
+    // datagrams_[0..datagramCount_) are pending, the rest keep their
+    // storage for reuse
+    std::vector<Datagram> datagrams_;
+    std::size_t datagramCount_;
+    std::size_t packetCount_;
+    long long oldestQueueTimeNs_;
+
+    std::vector<OutgoingDatagram> outgoing_;
+};
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCPACK_OSCTRANSMITQUEUE_H */
@@ -22,6 +22,9 @@ filter "system:windows"
     platforms { "Win64" }
     systemversion("latest")
 
+filter "system:linux"
+    platforms { "Linux" }
+
 filter { "system:windows", "options:clang" }
     toolset("msc-clangcl")
     buildoptions {
@@ -61,6 +64,26 @@ filter "platforms:Win64"
     }
     linkoptions {"/ignore:4099"}
 
+filter "platforms:Linux"
+    defines { "TM_OS_LINUX", "TM_OS_POSIX" }
+    includedirs { "$(TM_SDK_DIR)/headers" }
+    architecture "x64"
+    toolset "clang"
+    buildoptions {
+        "-fms-extensions",                   -- Allow anonymous struct as C inheritance.
+        "-mavx",                             -- AVX.
+        "-mfma",                             -- FMA.
+    }
+    libdirs { "$(TM_SDK_DIR)/lib/" .. _ACTION .. "/%{cfg.buildcfg}"}
+    disablewarnings {
+        "missing-field-initializers",   -- = {0} is OK.
+        "unused-parameter",             -- Useful for documentation purposes.
+        "unused-local-typedef",         -- We don't always use all typedefs.
+        "missing-braces",               -- = {0} is OK.
+        "microsoft-anon-tag",           -- Allow anonymous structs.
+    }
+    removeflags {"FatalWarnings"}
+
 filter "configurations:Debug"
     defines { "TM_CONFIGURATION_DEBUG", "DEBUG" }
     symbols "On"
@@ -76,8 +99,12 @@ project "themachinery_test_0005"
     language "C++"
     files {"*.inl", "*.h", "*.c"}
     sysincludedirs { "" }
-    links {"test_0005_motionclient", "winmm.lib", "Ws2_32.lib"}
+    links {"test_0005_motionclient"}
     filter "platforms:Win64"
+        links {"winmm.lib", "Ws2_32.lib"}
+        targetdir "$(TM_SDK_DIR)/bin/plugins"
+    filter "platforms:Linux"
+        links {"pthread"}
         targetdir "$(TM_SDK_DIR)/bin/plugins"
 
 project "test_0005_motionclient"
@@ -87,6 +114,49 @@ project "test_0005_motionclient"
     language "C++"
     files {"motionclient/*.inl", "motionclient/*.h", "motionclient/*.cpp", "osc/**.h", "osc/**.cpp", "ip/**.h", "ip/**.cpp", "cgltf/**.h", "cgltf/**.inl"}
     sysincludedirs { "" }
+    filter "system:windows"
+        removefiles {"ip/posix/**"}
+    filter "system:linux"
+        removefiles {"ip/win32/**"}
     filter "platforms:Win64"
         targetdir "$(TM_SDK_DIR)/bin/plugins"
+    filter "platforms:Linux"
+        pic "On"
+        targetdir "$(TM_SDK_DIR)/bin/plugins"
+
+
+-- Standalone tools, they only need the osc and ip sources.
+filter {}
+
+project "OscParseBench"
+    location "build/tools"
+    targetname "OscParseBench"
+    kind "ConsoleApp"
+    language "C++"
+    files {"tools/OscParseBench.cpp", "osc/OscReceivedElements.cpp", "osc/OscOutboundPacketStream.cpp", "osc/OscTypes.cpp"}
+    sysincludedirs { "" }
+    targetdir "bin/tools/%{cfg.buildcfg}"
+
+-- The same with the scalar string scans, compare the status digests of the two.
+project "OscParseBenchScalar"
+    location "build/tools"
+    targetname "OscParseBenchScalar"
+    kind "ConsoleApp"
+    language "C++"
+    files {"tools/OscParseBench.cpp", "osc/OscReceivedElements.cpp", "osc/OscOutboundPacketStream.cpp", "osc/OscTypes.cpp"}
+    defines { "OSC_NO_SIMD" }
+    sysincludedirs { "" }
+    targetdir "bin/tools/%{cfg.buildcfg}"
 
+-- Compares the receive backends of ip/posix, so Linux only.
+if os.istarget("linux") then
+    project "UdpReceiveBench"
+        location "build/tools"
+        targetname "UdpReceiveBench"
+        kind "ConsoleApp"
+        language "C++"
+        files {"tools/UdpReceiveBench.cpp", "osc/OscReceivedElements.cpp", "osc/OscOutboundPacketStream.cpp", "osc/OscTypes.cpp", "ip/IpEndpointName.cpp", "ip/posix/**.cpp"}
+        sysincludedirs { "" }
+        links {"pthread"}
+        targetdir "bin/tools/%{cfg.buildcfg}"
+end
@@ -33,6 +33,9 @@ static struct tm_task_system_api* tm_task_system_api;
 typedef struct tm_gameplay_state_o
 {
     uint64_t player_name;
+
+    // motion client pose last applied to the players
+    uint64_t pose_frame;
 } tm_gameplay_state_o;
 
 static void motionclient_run_task(void* data_, uint64_t task_id)
@@ -59,7 +62,10 @@ static void update(tm_gameplay_context_t *ctx)
 {
     tm_gameplay_state_o *state = ctx->state;
 
-    motion_listener_transform_data_t* data = motionclient_poll();
+    const motion_listener_transform_data_t* data = motionclient_poll();
+    if (data != NULL && data->frame == state->pose_frame) {
+        data = NULL; // no new pose since the last update
+    }
     TM_INIT_TEMP_ALLOCATOR(ta);
     tm_entity_t* players = g->entity->find_entities_with_tag(ctx, state->player_name, ta);
 
@@ -68,6 +74,9 @@ static void update(tm_gameplay_context_t *ctx)
         tm_scene_tree_component_t* stc = tm_entity_api->get_component(ctx->entity_ctx, players[i], tm_entity_api->lookup_component(ctx->entity_ctx, TM_TT_TYPE_HASH__SCENE_TREE_COMPONENT));
         if (stc != NULL && data != NULL) {
             for (uint32_t j = 0; j < data->availableCount; j++) {
+                if (data->hashes[j] == 0) {
+                    continue;
+                }
                 const uint32_t node_index = tm_scene_tree_component_api->node_index_from_name(stc, data->hashes[j], NODE_NOT_FOUND);
                 if (node_index != NODE_NOT_FOUND) {
                     tm_transform_t transform = tm_scene_tree_component_api->local_transform(stc, node_index);
@@ -76,10 +85,13 @@ static void update(tm_gameplay_context_t *ctx)
                     tm_scene_tree_component_api->set_local_transform(stc, node_index, &transform);
                 }
             }
-            data->availableCount = 0; // This practically disables polling
         }
     }
 
+    if (data != NULL) {
+        state->pose_frame = data->frame;
+    }
+
     TM_SHUTDOWN_TEMP_ALLOCATOR(ta);
 
 }
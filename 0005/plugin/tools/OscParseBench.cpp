@@ -0,0 +1,234 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+
+/*
+    OscParseBench times the non-throwing parser on a VMC frame and checks
+    its status results on randomly mutated packets.
+
+    usage: OscParseBench [mutated packet count]
+
+    the benchmark parses each /VMC/Ext/Bone/Pos message of a 22 bone frame
+    as a packet and a message and prints the time per message. the check
+    parses the mutated packets, bundle elements and message arguments
+    included, and prints a digest of every ParseStatus and argument count. the mutations are
+    the same in every build, so building once as usual and once with
+    OSC_NO_SIMD defined (the scalar scans) and comparing the digests checks
+    the vector scans against the scalar ones.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "osc/OscReceivedElements.h"
+#include "osc/OscOutboundPacketStream.h"
+
+
+namespace{
+
+// the string scans OscReceivedElements.cpp selects for this build
+const char *ScanName()
+{
+#if defined(OSC_NO_SIMD)
+    return "scalar";
+#elif defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+const char *const bones[] = {
+    "Hips", "Spine", "Chest", "UpperChest", "Neck", "Head",
+    "LeftShoulder", "LeftUpperArm", "LeftLowerArm", "LeftHand",
+    "RightShoulder", "RightUpperArm", "RightLowerArm", "RightHand",
+    "LeftUpperLeg", "LeftLowerLeg", "LeftFoot",
+    "RightUpperLeg", "RightLowerLeg", "RightFoot",
+    "LeftIndexProximal", "RightLittleDistal"
+};
+const int boneCount = (int)(sizeof(bones) / sizeof(bones[0]));
+
+// xorshift, so that every build mutates the same way
+struct Random{
+    osc::uint32 state;
+    Random() : state( 2463534242U ) {}
+    osc::uint32 Next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+// walks the arguments as a listener would, and counts them
+void WalkArguments( const osc::ReceivedMessage& message, unsigned long& arguments )
+{
+    for( osc::ReceivedMessageArgumentIterator i = message.ArgumentsBegin();
+            i != message.ArgumentsEnd(); ++i )
+        ++arguments;
+}
+
+// the first failing status of the packet, its elements and messages.
+// arguments counts the arguments of the messages parsed before it.
+osc::ParseStatus ParseAll( const char *data, std::size_t size, unsigned long& arguments )
+{
+    osc::ReceivedPacket packet;
+    osc::ParseStatus status = osc::ReceivedPacket::Parse( data, size, packet );
+    if( status != osc::PARSE_OK )
+        return status;
+
+    if( packet.IsMessage() ){
+        osc::ReceivedMessage message;
+        status = osc::ReceivedMessage::Parse( packet, message );
+        if( status == osc::PARSE_OK )
+            WalkArguments( message, arguments );
+        return status;
+    }
+
+    osc::ReceivedBundle bundle;
+    status = osc::ReceivedBundle::Parse( packet, bundle );
+    if( status != osc::PARSE_OK )
+        return status;
+
+    for( osc::ReceivedBundle::const_iterator i = bundle.ElementsBegin();
+            i != bundle.ElementsEnd(); ++i ){
+        if( i->IsBundle() ){
+            osc::ReceivedBundle element;
+            status = osc::ReceivedBundle::Parse( *i, element );
+        }else{
+            osc::ReceivedMessage element;
+            status = osc::ReceivedMessage::Parse( *i, element );
+            if( status == osc::PARSE_OK )
+                WalkArguments( element, arguments );
+        }
+        if( status != osc::PARSE_OK )
+            return status;
+    }
+    return osc::PARSE_OK;
+}
+
+void Benchmark()
+{
+    std::vector< std::vector<char> > messages;
+    for( int i=0; i < boneCount; ++i ){
+        char buffer[256];
+        osc::OutboundPacketStream p( buffer, sizeof(buffer) );
+        p << osc::BeginMessage( "/VMC/Ext/Bone/Pos" ) << bones[i]
+                << 1.f << 2.f << 3.f << 0.f << 0.f << 0.f << 1.f << osc::EndMessage;
+        messages.push_back( std::vector<char>( p.Data(), p.Data() + p.Size() ) );
+    }
+
+    const int rounds = 1000000;
+    unsigned long sink = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for( int r=0; r < rounds; ++r ){
+        for( std::size_t i=0; i < messages.size(); ++i ){
+            osc::ReceivedPacket packet;
+            osc::ReceivedMessage message;
+            sink += osc::ReceivedPacket::Parse( &messages[i][0], messages[i].size(), packet );
+            sink += osc::ReceivedMessage::Parse( packet, message );
+            sink += message.ArgumentCount();
+        }
+    }
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    std::printf( "%s scans: %.1f ns per message (%lu)\n", ScanName(),
+            seconds * 1e9 / ( (double)rounds * messages.size() ), sink );
+}
+
+void Check( long packetCount )
+{
+    // a bundle with the argument types the scans skip over
+    char buffer[1024];
+    osc::OutboundPacketStream p( buffer, sizeof(buffer) );
+    p << osc::BeginBundleImmediate
+        << osc::BeginMessage( "/VMC/Ext/Bone/Pos" ) << "Hips"
+            << 1.f << 2.f << 3.f << 0.f << 0.f << 0.f << 1.f << osc::EndMessage
+        << osc::BeginMessage( "/x" ) << osc::Blob( "abcde", 5 ) << (osc::int64)5 << true
+            << osc::BeginArray << 1 << osc::EndArray << osc::Symbol( "sym" ) << osc::EndMessage
+        << osc::BeginBundle( 7 ) << osc::BeginMessage( "/n" ) << 3.0 << osc::EndMessage << osc::EndBundle
+        << osc::EndBundle;
+    const std::vector<char> original( p.Data(), p.Data() + p.Size() );
+
+    Random random;
+    osc::uint32 digest = 2166136261U;
+    long malformed = 0;
+    std::vector<char> packet;
+    for( long i=0; i < packetCount; ++i ){
+        packet = original;
+        int mutations = 1 + (int)(random.Next() % 4);
+        for( int k=0; k < mutations; ++k ){
+            osc::uint32 r = random.Next();
+            std::size_t position = r % packet.size();
+            switch( (r >> 16) % 3 ){
+                case 0: packet[position] = (char)(r >> 24); break;
+                case 1: packet[position] = '\0'; break;
+                default: packet[position] = (char)0xFF; break;
+            }
+        }
+        std::size_t size = packet.size();
+        if( random.Next() % 10 == 0 )
+            size = random.Next() % (packet.size() + 1);
+
+        unsigned long arguments = 0;
+        osc::ParseStatus status = ParseAll( size > 0 ? &packet[0] : "", size, arguments );
+        if( status != osc::PARSE_OK )
+            ++malformed;
+        digest = (digest ^ (osc::uint32)status) * 16777619U;
+        digest = (digest ^ (osc::uint32)arguments) * 16777619U;
+    }
+
+    std::printf( "%s scans: %ld packets, %ld malformed, status digest %08x\n",
+            ScanName(), packetCount, malformed, (unsigned)digest );
+}
+
+} // anonymous namespace
+
+
+int main( int argc, char* argv[] )
+{
+    long packetCount = ( argc > 1 ) ? std::atol( argv[1] ) : 3000000;
+
+    Benchmark();
+    Check( packetCount );
+
+    return 0;
+}
@@ -0,0 +1,212 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+
+/*
+    UdpReceiveBench replays the same stream of VMC sized datagrams over
+    loopback into a SocketReceiveMultiplexer with each receive backend, so
+    the epoll and io_uring paths can be compared on one machine. linux only.
+
+    usage: UdpReceiveBench [datagram count] [datagrams per second]
+
+    the sender paces the datagrams at the given rate, 0 sends them as fast
+    as it can. each datagram is a 22 bone /VMC/Ext/Bone/Pos bundle carrying
+    its send time, from which the receiver takes the send to dispatch
+    latency. for each backend it prints the backend actually used, the
+    datagrams received and dropped, the latency percentiles, the receive
+    thread's cpu time per datagram and the statistics of the multiplexer.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+#include "osc/OscOutboundPacketStream.h"
+#include "ip/UdpSocket.h"
+#include "ip/PacketListener.h"
+
+
+namespace{
+
+const int port = 39541;
+
+long long MonotonicNs()
+{
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+long long ThreadCpuNs()
+{
+    struct timespec t;
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &t );
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+const char *const bones[] = {
+    "Hips", "Spine", "Chest", "UpperChest", "Neck", "Head",
+    "LeftShoulder", "LeftUpperArm", "LeftLowerArm", "LeftHand",
+    "RightShoulder", "RightUpperArm", "RightLowerArm", "RightHand",
+    "LeftUpperLeg", "LeftLowerLeg", "LeftFoot",
+    "RightUpperLeg", "RightLowerLeg", "RightFoot",
+    "LeftIndexProximal", "RightLittleDistal"
+};
+
+// the send time goes into the bundle time tag, bytes 8 to 15
+const std::size_t timeOffset = 8;
+
+std::vector<char> MakeFrame()
+{
+    std::vector<char> buffer( 4096 );
+    osc::OutboundPacketStream p( &buffer[0], buffer.size() );
+    p << osc::BeginBundleImmediate;
+    for( std::size_t i=0; i < sizeof(bones) / sizeof(bones[0]); ++i ){
+        p << osc::BeginMessage( "/VMC/Ext/Bone/Pos" ) << bones[i]
+            << 1.f << 2.f << 3.f << 0.f << 0.f << 0.f << 1.f << osc::EndMessage;
+    }
+    p << osc::EndBundle;
+    return std::vector<char>( p.Data(), p.Data() + p.Size() );
+}
+
+class LatencyListener : public PacketListener{
+public:
+    explicit LatencyListener( std::size_t expected )
+    {
+        latencies.reserve( expected );
+    }
+
+    virtual void ProcessPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        (void) remoteEndpoint;
+        long long sent;
+        if( size < (int)(timeOffset + sizeof(sent)) )
+            return;
+        std::memcpy( &sent, data + timeOffset, sizeof(sent) );
+        latencies.push_back( MonotonicNs() - sent );
+    }
+
+    std::vector<long long> latencies;
+};
+
+void Send( int count, int rate )
+{
+    UdpTransmitSocket socket( IpEndpointName( "127.0.0.1", port ) );
+    std::vector<char> frame = MakeFrame();
+
+    const long long start = MonotonicNs();
+    for( int i=0; i < count; ++i ){
+        if( rate > 0 ){
+            const long long due = start + (long long)i * 1000000000LL / rate;
+            while( MonotonicNs() < due )
+                ;
+        }
+        long long now = MonotonicNs();
+        std::memcpy( &frame[timeOffset], &now, sizeof(now) );
+        socket.Send( &frame[0], frame.size() );
+    }
+}
+
+double Percentile( const std::vector<long long>& sorted, double fraction )
+{
+    if( sorted.empty() )
+        return 0.;
+    std::size_t i = (std::size_t)(fraction * (double)(sorted.size() - 1));
+    return (double)sorted[i] / 1000.;
+}
+
+void Run( SocketReceiveBackend requested, int count, int rate )
+{
+    LatencyListener listener( (std::size_t)count );
+    UdpListeningReceiveSocket socket( IpEndpointName( IpEndpointName::ANY_ADDRESS, port ), &listener );
+    socket.SetEnableDropCounting( true );
+
+    SocketReceiveMultiplexer multiplexer( requested );
+    multiplexer.SetReceiveBatchSize( 32 );
+    multiplexer.AttachSocketListener( &socket, &listener );
+
+    long long cpuNs = 0;
+    std::thread receiver( [&multiplexer, &cpuNs](){
+        const long long start = ThreadCpuNs();
+        multiplexer.Run();
+        cpuNs = ThreadCpuNs() - start;
+    } );
+
+    // let the receiver get to its wait before the first datagram
+    std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+    Send( count, rate );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+    multiplexer.AsynchronousBreak();
+    receiver.join();
+
+    SocketReceiveStatistics statistics;
+    multiplexer.GetStatistics( statistics );
+
+    std::vector<long long> sorted( listener.latencies );
+    std::sort( sorted.begin(), sorted.end() );
+
+    std::printf( "%s backend%s:\n",
+            multiplexer.Backend() == IO_URING_RECEIVE_BACKEND ? "io_uring" : "wait",
+            multiplexer.Backend() != requested ? " (io_uring unavailable)" : "" );
+    std::printf( "    received %lu of %d, kernel drops %llu\n",
+            (unsigned long)listener.latencies.size(), count, statistics.kernelDrops );
+    std::printf( "    latency us: p50 %.1f p99 %.1f max %.1f\n",
+            Percentile( sorted, .5 ), Percentile( sorted, .99 ), Percentile( sorted, 1. ) );
+    std::printf( "    receive cpu %.0f ns per datagram\n",
+            listener.latencies.empty() ? 0. : (double)cpuNs / (double)listener.latencies.size() );
+    std::printf( "    wakeups %llu, batches %llu, average batch %.2f\n",
+            statistics.wakeups, statistics.batches, statistics.AverageBatchDepth() );
+}
+
+} // anonymous namespace
+
+
+int main( int argc, char* argv[] )
+{
+    int count = ( argc > 1 ) ? std::atoi( argv[1] ) : 200000;
+    int rate = ( argc > 2 ) ? std::atoi( argv[2] ) : 0;
+
+    Run( WAIT_RECEIVE_BACKEND, count, rate );
+    Run( IO_URING_RECEIVE_BACKEND, count, rate );
+
+    return 0;
+}